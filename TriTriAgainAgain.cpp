@@ -1,566 +1,453 @@
-#include <iostream>
-#include <vector>
-#include <string>
-#include <algorithm>
-
-using std::vector;
-using std::cout;
-using std::endl;
-
-const int MAX_LEN = 17;
-
-struct Point;
-vector<Point> translate(Point P);
-bool is_inside_triangle (Point pt, Point v1, Point v2, Point v3);
-
-struct Point {
-    float x;
-    float y;
-    Point(float X, float Y) : x(X), y(Y) {};
-};
-
-/*
- *  Important info in struct Point:
- *  1. Triangle dimensions expressed as ordered pair (base, height)
- *  2. All the possible offsets this (base, height) ordered pair can achieve while keeping the square (in the grid) 
- *     inside it.
- */
-
-struct valid_translations {
-    // Dimensions (variable: _dimensions) are represented as a point (x,y). 
-    // Actually represents dimensions as a (base, height) ordered pair.
-    Point _dimensions; 
-    vector<Point> _translations;
-    valid_translations(Point point, vector<Point> translations) : _dimensions(point), _translations(translations) {}; 
-};
-
-
-/*
- *      _x and _y are the X and Y coordinates of the right angle triangle.
- *      _area is the area of the triangle.
- *      
- *      _combinations holds all the possible dimensions of the triangle, as well as the respective
- *      valid offsets for each dimension
- *
- *      all_triangles holds all the possible valid triangle combinations (for each shape base/height combination) and each 
- *      triangle orientation. Given that a triangle has three vertices, they represent 1 triangle.
- *      For instance, a vector may contain 27 points. This means it contains 9 valid triangles. 
- */
-
-class Triangle {
-    private:
-
-        int _x;
-        int _y;
-        int _area;
-    
-    public:
-
-        vector<valid_translations> _combinations;
-        vector<Point> all_triangles; 
-
-        Triangle(int area, int x, int y) : _x(x), _y(y), _area(area) {
-            create_dimensions(_area, _combinations);
-            make_combinations(_x,_y,_combinations,all_triangles);
-        };
-
-        void create_dimensions(int area, vector<valid_translations>& combinations);
-        void make_combinations(int x, int y, vector<valid_translations>& combinations, vector<Point>& allTriangles);
-
-        vector<Point> translate(Point dimensions);
-
-        int inline getXC() const {return _x;};
-        int inline getYC() const {return _y;};
-
-        void print_dimensions() const;
-        void print_triangles() const;
-        
-        vector<valid_translations> getCombinations() {return _combinations;};
-};
-
-/* Calculate all valid integer base/height combinations given
- * the triangle's area. Do so by imagining the triangle is a square.
- *
- * A base must be at least 2 squares wide, otherwise, the 1 by 1 square
- * representing that triangle's area cannot fit in it.
- */
-
-void Triangle::create_dimensions(int area, vector<valid_translations>& combinations) {
-    int effectiveArea = 2 * area;
-
-    for (int base{2}; base < effectiveArea; ++base) {
-        int height;
-        if (effectiveArea % base == 0) {
-            height = effectiveArea / base;
-            combinations.push_back(valid_translations(Point(base, height), translate(Point(base, height))));
-        }
-    }
-    return;
-}
-
-vector<Point> Triangle::translate(Point dimensions) {
-    
-    vector<Point> results;
-
-    int shiftY{}, shiftX{};
-    
-    /*
-     * The box that our triangle contains is size 1 by 1
-     */
-
-    Point q1(1,1); 
-
-    // The three vertices of our triangle.
-    Point v1(shiftX,shiftY); 
-    Point v2(0, dimensions.y);
-    Point v3(dimensions.x, 0);
-
-    int maxHeight = dimensions.y;
-    while (is_inside_triangle(q1,v1,v2,v3)) {
-        shiftY = 0;
-        v1.x = shiftX;
-        v1.y = shiftY;
-        while (is_inside_triangle(q1,v1,v2,v3)) {
-            results.push_back(Point(shiftX, shiftY));
-            shiftY--;
-            v2.y--;
-            v3.y--;
-        }
-        v2.y = maxHeight;
-        v2.x--;
-        v3.y = 0;
-        v3.x--;
-        shiftX--;
-    }
-   return results;
-}
-
-/* Having a vector that contains all the possible dimensions and translations (offsets) to these
- * dimensions, we can print out each base/height and shift combination.
- *
- */
-
-void Triangle::print_dimensions() const {
-    for (const auto& j : _combinations) {
-        cout << j._dimensions.x << " " << j._dimensions.y << " = ";
-        for (int i{}; i < j._translations.size(); i++) {
-            cout << j._translations[i].x << ' ' << j._translations[i].y << ' ';
-        }
-        cout << "\n";
-    }
-    return;
-}
-
-/*
- *  This is a very meaty function. All our base/height and shift combinations
- *  apply to a triangle that is upright. But what if our triangle needs to point rightwards, 
- *  downwards, or even to the left? Well, we can take our potential translations (offsets) for each dimension
- *  and create a corresponding shift/offset for a triangle in the other directions. 
- *
- *  (aX, aY), (bX, bY), (cX, cY) will each represent valid triangle vertices for our triangle.
- *  The vector all_triangles will contain three vertices for each valid triangle placement on our board.
- *  
- *
- *
- */
-
-void Triangle::make_combinations(int X, int Y, vector<valid_translations>& combinations, vector<Point>& allTriangles) {
-    int aX, aY, bX, bY, cX, cY;
-    
-    // All valid triangle combinations in the upward direction.
-
-    for (int i{}; i < combinations.size();i++) { 
-        for (int j{}; j < combinations[i]._translations.size();j++) {
-        
-            aX = X + combinations[i]._translations[j].x;
-            aY = Y + combinations[i]._translations[j].y;
-            bX = aX + combinations[i]._dimensions.x;
-            bY = aY;
-            cX = aX;
-            cY = aY + combinations[i]._dimensions.y;
-
-            // The points must lie on the board.
-
-            if ( aX < 0 || aX > MAX_LEN || bX < 0 || bX > MAX_LEN ||cX < 0 || cX > MAX_LEN || 
-                 aY < 0 || aY > MAX_LEN || bY < 0 || bY > MAX_LEN ||cY < 0 || cY > MAX_LEN) {
-                continue;
-            }
-
-            // If points are valid, push them back into our allTriangles vector for this triangle.
-
-            allTriangles.push_back(Point(aX,aY));
-            allTriangles.push_back(Point(bX,bY));
-            allTriangles.push_back(Point(cX,cY));
-        }
-    }
-
-    // All valid triangle combinations in the right direction.
-
-    for (int i{}; i < combinations.size();i++) {
-        for (int j{}; j < combinations[i]._translations.size();j++) {
-    
-            aX = X + combinations[i]._translations[j].y;
-            aY = Y + std::abs(combinations[i]._translations[j].x) + 1;
-            bX = aX;
-            bY = aY - combinations[i]._dimensions.x;
-            cX = aX + combinations[i]._dimensions.y;
-            cY = aY;
-
-            if ( aX < 0 || aX > MAX_LEN || bX < 0 || bX > MAX_LEN ||cX < 0 || cX > MAX_LEN ||
-                 aY < 0 || aY > MAX_LEN || bY < 0 || bY > MAX_LEN ||cY < 0 || cY > MAX_LEN) {
-                continue;
-            }
-
-            allTriangles.push_back(Point(aX,aY));
-            allTriangles.push_back(Point(bX,bY));
-            allTriangles.push_back(Point(cX,cY));
-        }
-    }
-
-    // All valid triangle combinations in the downward direction.
-
-    for (int i{}; i < combinations.size(); ++i) { 
-        for (int j{}; j < combinations[i]._translations.size(); ++j) {
-
-            aX = X + std::abs(combinations[i]._translations[j].x) + 1;
-            aY = Y + std::abs(combinations[i]._translations[j].y) + 1;
-            bX = aX - combinations[i]._dimensions.x;
-            bY = aY;
-            cX = aX;
-            cY = aY - combinations[i]._dimensions.y;
-
-            if ( aX < 0 || aX > MAX_LEN || bX < 0 || bX > MAX_LEN ||cX < 0 || cX > MAX_LEN || 
-                 aY < 0 || aY > MAX_LEN || bY < 0 || bY > MAX_LEN ||cY < 0 || cY > MAX_LEN) {
-                continue;
-            }
-
-            allTriangles.push_back(Point(aX,aY));
-            allTriangles.push_back(Point(bX,bY));
-            allTriangles.push_back(Point(cX,cY));
-        }
-    }
-
-    // All valid triangle combinations in the left direction.
-
-    for (int i{}; i < combinations.size(); i++) { 
-        for (int j{}; j < combinations[i]._translations.size(); j++) {
-        
-            aX = X + std::abs(combinations[i]._translations[j].y) + 1;
-            aY = Y + combinations[i]._translations[j].x;
-            bX = aX;
-            bY = aY + combinations[i]._dimensions.x;
-            cX = aX - combinations[i]._dimensions.y;
-            cY = aY;
-
-            if ( aX < 0 || aX > MAX_LEN || bX < 0 || bX > MAX_LEN ||cX < 0 || cX > MAX_LEN ||
-                 aY < 0 || aY > MAX_LEN || bY < 0 || bY > MAX_LEN ||cY < 0 || cY > MAX_LEN) {
-                continue;
-            }
-
-            allTriangles.push_back(Point(aX,aY));
-            allTriangles.push_back(Point(bX,bY));
-            allTriangles.push_back(Point(cX,cY));
-        }
-    }
-
-    return;
-}
-
-/*
- * Print the contents of the all_triangles vector, remaining cognesant that
- * each three points is one triangle.
- */
-
-
-void Triangle::print_triangles() const {
-    for (int i{}; i < all_triangles.size();i++) {
-        cout << "( ";
-           cout << all_triangles[i].x << " " << all_triangles[i].y << ' ';
-        cout << ") |";
-        if ((i + 1) % 3 == 0) {
-            cout << "\n";
-        }
-    }
-    cout << "\n";
-    return;
-}
-
-////////////////////////////////////
-//   Point Comparison Functions   //
-////////////////////////////////////
-
-// Determines whether a point lies on another line.
-
-bool is_on_same_line(Point p, Point q, Point r) { 
-    if (q.x <= std::max(p.x, r.x) && q.x >= std::min(p.x, r.x) && 
-        q.y <= std::max(p.y, r.y) && q.y >= std::min(p.y, r.y)) {
-            return true; 
-        }
-    return false; 
-} 
-  
-
-
-int orientation(Point p, Point q, Point r) { 
-
-    int val = (q.y - p.y) * (r.x - q.x) - 
-              (q.x - p.x) * (r.y - q.y); 
-    
-    // Co-linear
-    if (val == 0) return 0;  
-    // Non-colinear (1 = clockwise, 2 = counterclock wise) 
-    return (val > 0) ? 1 : 2; 
-} 
-
-bool do_intersect(Point p1, Point q1, Point p2, Point q2) { 
-    // Find the four orientations needed for general and special cases 
-    int o1 = orientation(p1, q1, p2); 
-    int o2 = orientation(p1, q1, q2); 
-    int o3 = orientation(p2, q2, p1); 
-    int o4 = orientation(p2, q2, q1); 
-
-    // If the tips (vertices) of a triangle touch, we consider it as NOT
-    // crossing. 
-    if (o1 == 0 || o2 == 0 || o3 == 0 || o4 == 0) return false;
-
-    // General case 
-    if (o1 != o2 && o3 != o4) 
-        return true; 
-  
-    // Special Cases 
-    // p1, q1 and p2 are colinear and p2 lies on segment p1q1 
-    if (o1 == 0 && is_on_same_line(p1, p2, q1)) return false;  
-  
-    // p1, q1 and q2 are colinear and q2 lies on segment p1q1 
-    if (o2 == 0 && is_on_same_line(p1, q2, q1)) return false; 
-  
-    // p2, q2 and p1 are colinear and p1 lies on segment p2q2 
-    if (o3 == 0 && is_on_same_line(p2, p1, q2)) return false; 
-  
-     // p2, q2 and q1 are colinear and q1 lies on segment p2q2 
-    if (o4 == 0 && is_on_same_line(p2, q1, q2)) return false; 
-  
-    return false; // Doesn't fall in any of the above cases 
-} 
-
-float sign (Point p1, Point p2, Point p3) {
-    return (p1.x - p3.x) * (p2.y - p3.y) - (p2.x - p3.x) * (p1.y - p3.y);
-}
-
-/*
- * Given a point of interest, pt, find out whether or not it lies in 
- * a triangle with vertices v1, v2, and v3.
- */
-
-bool is_inside_triangle (Point pt, Point v1, Point v2, Point v3) {
-    float d1, d2, d3;
-    bool has_neg, has_pos;
-
-    d1 = sign(pt, v1, v2);
-    d2 = sign(pt, v2, v3);
-    d3 = sign(pt, v3, v1);
-
-    has_neg = (d1 < 0) || (d2 < 0) || (d3 < 0);
-    has_pos = (d1 > 0) || (d2 > 0) || (d3 > 0);
-
-    return !(has_neg && has_pos);
-}
-/*
- * Given a vector of valid triangles, figure out whether another triangle is contained within it
- */
-
-
-bool is_triangle_contained_in_another_triangle(vector<Point>& triangle_vertices, Point p, Point q, Point r) { 
-    for (int i{}; i < triangle_vertices.size(); i += 3) {
-        if (is_inside_triangle(p,triangle_vertices[i],triangle_vertices[i+1],triangle_vertices[i+2]) &&
-            is_inside_triangle(q,triangle_vertices[i],triangle_vertices[i+1],triangle_vertices[i+2]) && 
-            is_inside_triangle(r,triangle_vertices[i],triangle_vertices[i+1],triangle_vertices[i+2])) return true;
-    }
-    return false;
-}
-
-/*
- * Given a vector of valid triangles and three points, find out whether a point from the vector lies within these three points.
- */
-
-bool triangle_contains_another_triangle(vector<Point>& triangle_vertices, Point p, Point q, Point r) {
-    for (int i{}; i < triangle_vertices.size(); i += 3) {
-        Point vertex_1(triangle_vertices[i].x,triangle_vertices[i].y);
-        Point vertex_2(triangle_vertices[i+1].x, triangle_vertices[i+1].y);
-        Point vertex_3(triangle_vertices[i+2].x, triangle_vertices[i+2].y);
-
-        if (is_inside_triangle(vertex_1, p, q, r) &&
-            is_inside_triangle(vertex_2, p, q, r) && 
-            is_inside_triangle(vertex_3, p, q, r)) return true;
-            
-    }
-    return false;
-}
-
-
-////////////////////////////////////
-//   Preprocessing and Solution   //
-////////////////////////////////////
-
-/*
-     *  Preprocess all the triangles. Get rid of all vertices of valid triangles that overlap.
-     *  For instance, it's possible that Triangle #1 has points P1, P2, and P3, which are
-     *  a valid set of vertices (valid as in they are on the 17 by 17 board, and contain the
-     *  1 by 1 box representing the triangles area within them); but, these vertices cross
-     *  with Triangle #2, which has a valid set of vertices that cross Triangle #1s
-     *  
-     *  THIS CUTS RUNTIME IN HALF.
-     */
-
-void pre_process_valid_triangles(vector<Triangle>& board) {
-    for (int i{}; i < board.size(); i++) {
-        for (int j{}; j < board[i].all_triangles.size(); j += 3) {
-            Point p(board[i].all_triangles[j].x, board[i].all_triangles[j].y);
-            Point q(board[i].all_triangles[j+1].x, board[i].all_triangles[j+1].y);
-            Point r(board[i].all_triangles[j+2].x, board[i].all_triangles[j+2].y);
-            for (int k{}; k < board.size(); k++) {
-                if (k == i) continue;
-                Point a(board[k].getXC(), board[k].getYC());
-                Point b(board[k].getXC(), board[k].getYC() + 1);
-                Point c(board[k].getXC() + 1, board[k].getYC() + 1);
-                Point d(board[k].getXC() + 1, board[k].getYC());
-
-                if (do_intersect(p, q, a, b) || do_intersect(p, q, a, c) || do_intersect(p, q, a, d) ||
-                    do_intersect(p, q, b, c) || do_intersect(p, q, b, d) || do_intersect(p, q, c, d) ||
-                    do_intersect(p, r, a, b) || do_intersect(p, r, a, c) || do_intersect(p, q, a, d) ||
-                    do_intersect(p, r, b, c) || do_intersect(p, r, b, d) || do_intersect(p, r, c, d) ||
-                    do_intersect(q, r, a, b) || do_intersect(q, r, a, c) || do_intersect(q, q, a, d) ||
-                    do_intersect(q, r, b, c) || do_intersect(q, r, b, d) || do_intersect(q, r, c, d)) {
-                    board[i].all_triangles.erase(board[i].all_triangles.begin() + j, board[i].all_triangles.begin() + j + 3);
-                    break;
-                }
-            }
-        }
-    }
-}
-
-
-
-void print_solution(const vector<Point>& board) {
-    for (int j{}; j < board.size(); j += 3) {
-        cout << "Printing Triangle Coordinates: ";
-        cout << "(" << board[j].x << "," << board[j].y <<  ") | (";
-        cout << board[j+1].x << "," << board[j+1].y << ") | (" ;
-        cout << board[j+2].x << "," << board[j+2].y << ") ";
-        cout << "\n";
-    }
-    cout << "\n";
-}
-
-void solution(vector<Triangle>& board, int index, vector<Point> solution_vector) {
-
-    // Print the index/triangle I'm operating on for clarity as the program cracks the puzzle.
-    cout << (std::string(index, '-')) << index << endl;
-
-    if (index == board.size()) {
-
-        print_solution(solution_vector);
-        exit(0);
-
-    }
-
-    for (int i{}; i < board[index].all_triangles.size(); i += 3) {
-        Point p = board[index].all_triangles[i];
-        Point q = board[index].all_triangles[i+1];
-        Point r = board[index].all_triangles[i+2];
-        
-        bool is_triangle_valid = true;
-        for (int j{}; j < solution_vector.size(); j += 3) {
-            if (do_intersect(p,q,solution_vector[j],solution_vector[j+1])) {
-                    is_triangle_valid = false;
-                    break;
-            }
-
-            if (do_intersect(p,q,solution_vector[j],solution_vector[j+2])) {
-                    is_triangle_valid = false;
-                    break;
-            }
-
-            if (do_intersect(p,q,solution_vector[j+2],solution_vector[j+1])) {
-                    is_triangle_valid = false; 
-                    break;
-            }
-
-            if (do_intersect(p,r,solution_vector[j],solution_vector[j+1])) {
-                    is_triangle_valid = false;
-                    break;
-            }
-
-            if (do_intersect(p,r,solution_vector[j],solution_vector[j+2])) {
-                    is_triangle_valid = false;
-                    break;
-            }
-
-            if (do_intersect(p,r,solution_vector[j+2],solution_vector[j+1])) {
-                    is_triangle_valid = false;
-                    break;
-            }
-
-            if (do_intersect(q,r,solution_vector[j],solution_vector[j+1])) {
-                    is_triangle_valid = false;
-                    break;
-            }
-
-            if (do_intersect(q,r,solution_vector[j],solution_vector[j+2])) {
-                    is_triangle_valid = false;
-                    break;
-            }
-
-            if (do_intersect(q,r,solution_vector[j+2],solution_vector[j+1])) {
-                    is_triangle_valid = false; 
-                    break;
-            }
-
-        }
-
-        if (is_triangle_valid) {
-            
-            if(is_triangle_contained_in_another_triangle(solution_vector,p,q,r)) {
-                is_triangle_valid = false; // If this triangle is in others
-            }
-
-            if(triangle_contains_another_triangle(solution_vector,p,q,r)) {
-                is_triangle_valid = false;
-            }
-        }
-
-        if (is_triangle_valid) {
-                solution_vector.insert(solution_vector.end(), {q, p, r});
-                solution(board, index + 1, solution_vector);
-                solution_vector.erase(solution_vector.end() - 3, solution_vector.end());
-        }
-    }
-    return;  
-}
-
-int main() {
-
-    // This is the initial board, as provided in the puzzle.
-    // The board contains 29 triangles. 
-
-    vector<Triangle> init_board = { {2,3,0}, {18,7,0}, {12,2,1}, {4,13,1}, {3,4,2}, {7,11,2},
-                                     {6,16,2}, {6,0,3}, {9,3,4}, {11,9,4}, {8,14,5}, {4,0,6},
-                                     {14,5,6}, {18,15,6}, {20,8,8}, {7,1,10}, {3,11,10},
-                                     {3,16,10}, {3,2,11}, {7,7,12}, {10,13,12}, {5,16,13},
-                                     {4,0,14}, {10,5,14}, {3,12,14},  {12,3,15}, {7,14,15},
-                                     {8,9,16}, {2,13,16} };
-
-    // This vector will hold the answer.
-    // Every three points will be the correct vertices of an individual triangle
-    vector<Point> acceptable_triangle_vertices;
-    
-    // Get rid of any valid triangle orientations that intersect with valid orientations
-    // before searching for the solution. This cuts runtime in half, as it doesn't need checking over
-    // 400 triangles that are valid when viewed in isolation, but intersect with other existing triangles.
-    pre_process_valid_triangles(init_board);
-
-    // Run the recursive solution. 
-    solution(init_board, 0, acceptable_triangle_vertices);
-
-    return 0;
+#include "TriTriSolver.h"
+
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <cerrno>
+#include <chrono>
+#include <sstream>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace tritri;
+using std::cout;
+using std::vector;
+
+/*
+ *  Usage: TriTriAgainAgain [--mode static|fc] [--threads N] [--split-depth D] [--stats] [--progress SECONDS]
+ *                          [--all | --count] [--limit N] [--no-backjump] [--nogoods N]
+ *                          [--no-value-order] [--seed S] [--restarts NODES] [--portfolio N]
+ *                          [--cubes DEPTH [--cube-dir DIR] [--processes N]] [--subproblem]
+ *                          [--checkpoint FILE [--checkpoint-every SECONDS] [--resume]] [--session] [puzzle-file]
+ *
+ *  Solves the puzzle in puzzle-file ("-" reads it from standard input), or the published puzzle without one.
+ *  --mode picks the search_mode; fc (forward checking) is the default. --threads defaults to one worker per
+ *  hardware thread. See search_options for --split-depth and --progress, and for backjumping (--no-backjump
+ *  turns it off) and --nogoods, the size of each worker's nogood cache. --no-value-order tries candidates in ID
+ *  order rather than least constraining first. --seed breaks ties at random, and --restarts restarts the search
+ *  on a Luby schedule of that many nodes.
+ *
+ *  --portfolio runs N strategies at once (see default_portfolio, seeded from --seed) and prints the solution of
+ *  whichever settles the puzzle first; it looks for the first solution only, and uses one thread per strategy.
+ *
+ *  --cubes splits the search into subproblem files in --cube-dir ("cubes" by default), one for every way of placing
+ *  the first DEPTH triangles (see expand_cubes), and solves them with --processes worker processes at once (one per
+ *  hardware thread by default). Each worker is this program run on one file with --subproblem and one thread, with
+ *  its output in the file's name plus ".out". The first solution stops the rest; with --count their counts are
+ *  added up. --processes 0 only writes the files and lists them, for running anywhere that can see them, such as
+ *  the machines of a batch farm sharing a filesystem. --subproblem reads a subproblem file instead of a puzzle.
+ *
+ *  --checkpoint saves what's left of the search to FILE every --checkpoint-every seconds (60 by default), and
+ *  --resume carries on from FILE if it's there, for the same puzzle and options. FILE is removed once the search
+ *  is over.
+ *
+ *  --session loads the puzzle into a puzzle_session and then takes edits on standard input, one a line: "add AREA X Y",
+ *  "move X Y TO_X TO_Y" and "remove X Y", clues being found by their square, and "solve", which prints the first
+ *  solution, or the count with --count, as it would for a puzzle file. With --stats each solve also reports how long
+ *  it took and where it started from. A puzzle_session keeps what an edit didn't touch, and starts from the last
+ *  solution, so a solve after a small edit takes a few milliseconds, for an editor to check a puzzle as it's set.
+ *
+ *  By default the first solution found is printed. --all prints every solution as it is found instead, and
+ *  --count only prints how many there are. --limit stops after N solutions, so "--count --limit 2" tells a
+ *  puzzle with a unique solution (1) from one without (2); on its own it means --all --limit N.
+ *
+ *  --stats prints how many duplicate placements each clue had to standard error, then search_stats once the search is
+ *  over, or a line for each strategy of a portfolio.
+ */
+
+const char* const usage = " [--mode static|fc] [--threads N] [--split-depth D] [--stats] [--progress SECONDS]"
+                          " [--all | --count] [--limit N] [--no-backjump] [--nogoods N]"
+                          " [--no-value-order] [--seed S] [--restarts NODES] [--portfolio N]"
+                          " [--cubes DEPTH [--cube-dir DIR] [--processes N]] [--subproblem]"
+                          " [--checkpoint FILE [--checkpoint-every SECONDS] [--resume]] [--session] [puzzle-file]";
+
+/*
+ *  Start `self` on subproblem `file` with `args`, its standard output going to file + ".out". Returns its process
+ *  ID, or -1 if it couldn't be started.
+ */
+
+pid_t start_worker(const char* self, const std::string& file, const vector<std::string>& args) {
+    vector<std::string> words{self};
+    words.insert(words.end(), args.begin(), args.end());
+    words.insert(words.end(), {"--subproblem", file});
+    vector<char*> argv_out;
+    for (std::string& word : words) argv_out.push_back(&word[0]);
+    argv_out.push_back(nullptr);
+    std::string out_file = file + ".out";
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        int out = open(out_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (out < 0 || dup2(out, STDOUT_FILENO) < 0) _exit(127);
+        close(out);
+        execvp(self, argv_out.data());
+        _exit(127);
+    }
+    return pid;
+}
+
+// The whole of `path`, or nothing if it can't be read.
+std::string read_file(const std::string& path) {
+    std::ifstream in(path);
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+}
+
+/*
+ *  Solve the subproblem `files` with up to `processes` workers running at once, and print what they found: the
+ *  first solution, or with `count` the number of solutions in all (up to `limit`, if that's not 0). A worker's exit
+ *  status says how it went, as this program's own does: 0 found something, 1 found nothing, anything else failed.
+ *  Once the answer is in, the workers still running are sent SIGTERM. Returns the exit status for main.
+ */
+
+int run_cubes(const char* self, const vector<std::string>& files, const vector<std::string>& args, int processes,
+              bool count, uint64_t limit) {
+    std::map<pid_t, std::string> running;
+    size_t next = 0;
+    bool done = false, found = false, failed = false;
+    uint64_t total = 0;
+
+    while ((!done && next < files.size()) || !running.empty()) {
+        while (!done && next < files.size() && running.size() < processes) {
+            pid_t pid = start_worker(self, files[next], args);
+            if (pid < 0) {
+                std::cerr << files[next] << ": cannot start a worker: " << std::strerror(errno) << "\n";
+                failed = done = true;
+                break;
+            }
+            running[pid] = files[next++];
+        }
+        if (running.empty()) break;
+
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) break;
+        auto worker = running.find(pid);
+        if (worker == running.end()) continue;
+        std::string file = worker->second;
+        running.erase(worker);
+        if (done) continue;
+
+        if (!WIFEXITED(status) || WEXITSTATUS(status) > 1) {
+            std::cerr << file << ": the worker failed; see " << file << ".out\n";
+            failed = done = true;
+        } else if (count) {
+            total += std::strtoull(read_file(file + ".out").c_str(), nullptr, 10);
+            done = limit && total >= limit;
+        } else if (WEXITSTATUS(status) == 0) {
+            cout << read_file(file + ".out");
+            found = done = true;
+        }
+
+        if (done) {
+            for (const auto& other : running) kill(other.first, SIGTERM);
+        }
+    }
+
+    if (failed) return 2;
+    if (count) {
+        cout << (limit ? std::min(total, limit) : total) << "\n";
+        return total ? 0 : 1;
+    }
+    if (!found) {
+        cout << "No solution found.\n";
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ *  Apply the edits on standard input to `session`, solving whenever asked to (see --session above). Returns the exit
+ *  status for main: 0, or 2 if some line couldn't be made sense of or applied.
+ */
+
+int run_session(puzzle_session& session, const search_options& options, bool want_stats, bool count) {
+    static const char* const starts[] = {"from the top", "from the last solution",
+                                         "from the last solution, with the edited clues' neighbours freed"};
+    int status = 0;
+    std::string line;
+    for (int number = 1; std::getline(std::cin, line); number++) {
+        std::istringstream words(line.substr(0, line.find('#')));
+        std::string command, error;
+        int a, b, c, d;
+        if (!(words >> command)) continue;
+
+        bool applied;
+        if (command == "add" && words >> a >> b >> c) {
+            applied = session.add_clue(a, b, c, error);
+        } else if (command == "move" && words >> a >> b >> c >> d) {
+            applied = session.move_clue(a, b, c, d, error);
+        } else if (command == "remove" && words >> a >> b) {
+            applied = session.remove_clue(a, b, error);
+        } else if (command == "solve") {
+            search_stats stats;
+            auto start = std::chrono::steady_clock::now();
+            uint64_t found = session.solve(options, want_stats ? &stats : nullptr);
+            std::chrono::duration<double, std::milli> took = std::chrono::steady_clock::now() - start;
+
+            if (count) {
+                cout << found << "\n";
+            } else if (!found) {
+                cout << "No solution found.\n";
+            } else {
+                print_placements(cout, session._board, session._conflicts, session._solution_ids);
+            }
+            cout.flush();
+            if (want_stats) {
+                print_stats(std::cerr, session._board, stats);
+                std::cerr << "Solved in " << took.count() << " ms, " << starts[session._warm_start] << "\n";
+            }
+            continue;
+        } else {
+            applied = false;
+            error = "expected add AREA X Y, move X Y TO_X TO_Y, remove X Y or solve";
+        }
+        if (!applied) {
+            std::cerr << "line " << number << ": " << error << "\n";
+            status = 2;
+        }
+    }
+    return status;
+}
+
+int main(int argc, char* argv[]) {
+
+    search_options options;
+    options.threads = std::max(1u, std::thread::hardware_concurrency());
+    bool want_stats = false;
+    bool all = false, count = false;
+    long long limit = -1;
+    int portfolio = 0;
+    int cube_depth = 0;
+    std::string cube_dir = "cubes";
+    int processes = std::max(1u, std::thread::hardware_concurrency());
+    bool subproblem = false;
+    bool resume = false;
+    bool session = false;
+    const char* puzzle_file = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            options.threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--split-depth" && i + 1 < argc) {
+            options.split_depth = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--mode" && i + 1 < argc && (std::string(argv[i + 1]) == "static" || std::string(argv[i + 1]) == "fc")) {
+            options.mode = std::string(argv[++i]) == "static" ? search_mode::static_order : search_mode::forward_checking;
+        } else if (arg == "--stats") {
+            want_stats = true;
+        } else if (arg == "--progress" && i + 1 < argc) {
+            options.progress_seconds = std::atof(argv[++i]);
+        } else if (arg == "--no-backjump") {
+            options.backjumping = false;
+        } else if (arg == "--no-value-order") {
+            options.value_order = false;
+        } else if (arg == "--seed" && i + 1 < argc) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--restarts" && i + 1 < argc) {
+            options.restart_nodes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--portfolio" && i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+            portfolio = std::atoi(argv[++i]);
+        } else if (arg == "--cubes" && i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+            cube_depth = std::atoi(argv[++i]);
+        } else if (arg == "--cube-dir" && i + 1 < argc) {
+            cube_dir = argv[++i];
+        } else if (arg == "--processes" && i + 1 < argc) {
+            processes = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            options.checkpoint_path = argv[++i];
+        } else if (arg == "--checkpoint-every" && i + 1 < argc && std::atof(argv[i + 1]) > 0) {
+            options.checkpoint_seconds = std::atof(argv[++i]);
+        } else if (arg == "--resume") {
+            resume = true;
+        } else if (arg == "--session") {
+            session = true;
+        } else if (arg == "--subproblem") {
+            subproblem = true;
+        } else if (arg == "--nogoods" && i + 1 < argc) {
+            options.nogood_capacity = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--all" && !count) {
+            all = true;
+        } else if (arg == "--count" && !all) {
+            count = true;
+        } else if (arg == "--limit" && i + 1 < argc && std::atoll(argv[i + 1]) > 0) {
+            limit = std::atoll(argv[++i]);
+        } else if (!puzzle_file && (arg == "-" || arg[0] != '-')) {
+            puzzle_file = argv[i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << usage << "\n";
+            return 2;
+        }
+    }
+    if (portfolio && (all || count || limit > 0)) {
+        std::cerr << argv[0] << ": --portfolio only looks for the first solution\n";
+        return 2;
+    }
+    if (cube_depth && (all || (limit > 0 && !count) || portfolio)) {
+        std::cerr << argv[0] << ": --cubes looks for the first solution or counts them, with one search per cube\n";
+        return 2;
+    }
+    if (!options.checkpoint_path.empty() && (portfolio || cube_depth)) {
+        std::cerr << argv[0] << ": --checkpoint is for a single search\n";
+        return 2;
+    }
+    if (resume && options.checkpoint_path.empty()) {
+        std::cerr << argv[0] << ": --resume needs --checkpoint\n";
+        return 2;
+    }
+    if (session && (all || (limit > 0 && !count) || portfolio || cube_depth || !options.checkpoint_path.empty() ||
+                    subproblem || (puzzle_file && std::string(puzzle_file) == "-"))) {
+        std::cerr << argv[0] << ": --session looks for the first solution or counts them, of a puzzle file, with its "
+                     "edits on standard input\n";
+        return 2;
+    }
+
+    puzzle loaded;
+    if (!puzzle_file) {
+        loaded = published_puzzle();
+    } else {
+        std::ifstream file;
+        if (std::string(puzzle_file) != "-") {
+            file.open(puzzle_file);
+            if (!file) {
+                std::cerr << puzzle_file << ": cannot open\n";
+                return 2;
+            }
+        }
+
+        std::string error;
+        std::istream& in = file.is_open() ? file : std::cin;
+        if (!(subproblem ? read_subproblem(in, loaded, error) : read_puzzle(in, loaded, error))) {
+            std::cerr << puzzle_file << ": " << error << "\n";
+            return 2;
+        }
+    }
+    vector<Triangle>& init_board = loaded._board;
+
+    if (session) {
+        puzzle_session editing(loaded);
+        if (count) options.limit = limit > 0 ? limit : 0;
+        return run_session(editing, options, want_stats, count);
+    }
+
+    // Throw out every candidate that covers some other clue's square, since no solution can use it. That takes
+    // the published puzzle from 879 candidates down to 387 before anything else sees them.
+    pre_process_valid_triangles(init_board);
+
+    // Work out which pairs of the remaining placements overlap, once, up front.
+    conflict_matrix conflicts = build_conflict_matrix(init_board);
+
+    // Then throw out every placement that overlaps all of what's left for some other triangle, until none do.
+    propagate_arc_consistency(init_board, conflicts);
+
+    // Put each triangle's least constraining placements first, unless asked not to.
+    if (options.value_order) order_least_constraining(init_board, conflicts);
+
+    // Cut the search up into subproblem files, and solve them in worker processes unless asked not to.
+    if (cube_depth) {
+        mkdir(cube_dir.c_str(), 0777);
+        vector<std::string> files;
+        bool written = true;
+        expand_cubes(conflicts, cube_depth, [&](const uint64_t* domains) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "/cube-%06zu.txt", files.size() + 1);
+            files.push_back(cube_dir + name);
+            std::ofstream out(files.back());
+            out << "# Cube " << files.size() << ", " << cube_depth << " deep.\n";
+            write_subproblem(out, init_board, conflicts, domains);
+            written = written && bool(out);
+        });
+        if (!written) {
+            std::cerr << cube_dir << ": cannot write the subproblem files\n";
+            return 2;
+        }
+
+        if (!processes) {
+            for (const std::string& file : files) cout << file << "\n";
+            return 0;
+        }
+
+        vector<std::string> args{"--threads", "1", "--mode", options.mode == search_mode::static_order ? "static" : "fc",
+                                 "--nogoods", std::to_string(options.nogood_capacity)};
+        if (count) args.push_back("--count");
+        if (limit > 0) args.insert(args.end(), {"--limit", std::to_string(limit)});
+        if (!options.backjumping) args.push_back("--no-backjump");
+        if (!options.value_order) args.push_back("--no-value-order");
+        if (options.seed) args.insert(args.end(), {"--seed", std::to_string(options.seed)});
+        if (options.restart_nodes) args.insert(args.end(), {"--restarts", std::to_string(options.restart_nodes)});
+        return run_cubes(argv[0], files, args, processes, count, limit > 0 ? limit : 0);
+    }
+
+    // This will hold the answer: the ID of the placement chosen for each triangle.
+    vector<int> solution_ids;
+    search_stats stats;
+
+    all = all || (limit > 0 && !count);
+    if (all || count) options.limit = limit > 0 ? limit : 0;
+    solution_writer writer(cout, init_board, conflicts);
+    if (all) {
+        options.sink = [&writer](const vector<int>& placed_ids) { writer.write(placed_ids); };
+    }
+
+    if (want_stats) {
+        print_duplicates(std::cerr, init_board);
+    }
+
+    // Pick up where a checkpoint left off, if asked to and there is one.
+    search_checkpoint checkpoint;
+    std::ifstream saved;
+    if (resume) saved.open(options.checkpoint_path);
+    if (saved.is_open()) {
+        std::string error;
+        if (!read_checkpoint(saved, init_board, conflicts, options.mode, checkpoint, error)) {
+            std::cerr << options.checkpoint_path << ": " << error << "\n";
+            return 2;
+        }
+        options.resume = &checkpoint;
+    }
+
+    // Run the search, or a portfolio of them.
+    uint64_t found;
+    if (portfolio) {
+        vector<search_options> strategies = default_portfolio(portfolio, options.seed);
+        vector<search_stats> strategy_stats;
+        int winner;
+        found = portfolio_solution(init_board, conflicts, strategies, solution_ids, winner,
+                                   want_stats ? &strategy_stats : nullptr);
+        if (want_stats) {
+            print_portfolio_stats(std::cerr, strategies, strategy_stats, winner);
+        }
+    } else {
+        found = parallel_solution(init_board, conflicts, options, solution_ids, want_stats ? &stats : nullptr);
+        if (want_stats) {
+            print_stats(std::cerr, init_board, stats);
+        }
+        if (!options.checkpoint_path.empty()) std::remove(options.checkpoint_path.c_str());
+    }
+    writer.flush();
+    if (count) {
+        cout << found << "\n";
+        return found ? 0 : 1;
+    }
+    if (!found) {
+        cout << "No solution found.\n";
+        return 1;
+    }
+
+    if (!all && solution_ids.empty()) {
+        cout << "Found " << found << (found == 1 ? " solution" : " solutions") << ", but not which.\n";
+    } else if (!all) {
+        print_placements(cout, init_board, conflicts, solution_ids);
+    }
+
+    return 0;
 }
\ No newline at end of file
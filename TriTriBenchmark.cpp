@@ -0,0 +1,358 @@
+#include "TriTriSolver.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdlib>
+
+using namespace tritri;
+using std::cout;
+using std::vector;
+
+/*
+ *  Times each phase of the solver on its own, on the published puzzle and on generated puzzles of growing size:
+ *
+ *  create_dimensions              Triangle::create_dimensions (and Triangle::translate) for every clue, uncached
+ *  make_shapes                    Triangle::make_shapes for every clue, uncached
+ *  make_combinations              Triangle::make_combinations for every clue, from its cached shapes
+ *  build_board                    constructing every clue's Triangle, as the solver does (shape cache warm)
+ *  pre_process_valid_triangles    on a freshly built board
+ *  build_conflict_matrix          on the preprocessed board
+ *  propagate_arc_consistency      on a copy of the preprocessed board and its conflict matrix
+ *  order_least_constraining       on a copy of the propagated board and its conflict matrix
+ *  solution                       parallel_solution, cut off after --time-limit seconds
+ *  puzzle_solver                  the whole of the above, from the built board, through one puzzle_solver kept from
+ *                                 run to run
+ *  batch_solver                   one copy of the puzzle per thread, as one batch through a batch_solver
+ *
+ *  The last two are only run if the search finished inside the time limit, since they can't be cut off.
+ *  Every phase is run --repeat times. The output is one JSON object per phase per puzzle, one per line, so runs can be
+ *  diffed or loaded straight into a script.
+ */
+
+////////////////////////////////////
+//      Puzzle Generation         //
+////////////////////////////////////
+
+/*
+ *  splitmix64. Written out here instead of using <random>'s distributions so that a seed gives the same puzzle
+ *  on every compiler and standard library.
+ */
+
+struct splitmix64 {
+    uint64_t state;
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [0, n).
+    int below(int n) { return int(next() % uint64_t(n)); }
+};
+
+/*
+ *  Generate a size by size puzzle with (up to) `clues` clues that is known to have a solution.
+ *
+ *  Right triangles with whole number sides are dropped at random places on the board, skipping any that would
+ *  overlap one already there, and each one gets a clue on a random square that lies completely inside it. Those
+ *  triangles are then a solution. If the board fills up before `clues` triangles fit, the puzzle has fewer clues.
+ *  Clues are listed in reading order, like the published puzzle.
+ */
+
+puzzle generate_puzzle(int size, int clues, uint64_t seed) {
+    splitmix64 random{seed};
+    placement_list placed;
+
+    struct clue { int area, x, y; };
+    vector<clue> chosen;
+
+    for (int attempts = clues * 1000; chosen.size() < clues && attempts > 0; attempts--) {
+        int area = 2 + random.below(19);
+
+        // Every (base, height) with base * height == 2 * area that fits on the board.
+        vector<Point> dimensions;
+        for (int base{2}; base < 2 * area; base++) {
+            int height = 2 * area / base;
+            if (2 * area % base == 0 && base <= size && height <= size) dimensions.push_back(Point(base, height));
+        }
+        if (dimensions.empty()) continue;
+
+        Point dimension = dimensions[random.below(dimensions.size())];
+        int base = dimension.x, height = dimension.y;
+        int left = random.below(size - base + 1), bottom = random.below(size - height + 1);
+
+        // The right angle goes in one of the four corners of the bounding box.
+        int corner = random.below(4);
+        int cornerX = (corner & 1) ? left + base : left;
+        int cornerY = (corner & 2) ? bottom + height : bottom;
+        placement_list candidate;
+        candidate.push_back(cornerX, cornerY, (corner & 1) ? left : left + base, cornerY,
+                            cornerX, (corner & 2) ? bottom : bottom + height);
+
+        bool overlaps = false;
+        for (int i{}; i < placed.size() && !overlaps; i++) {
+            overlaps = placements_conflict(candidate, 0, placed, i);
+        }
+        if (overlaps) continue;
+
+        // The squares entirely inside the triangle.
+        vector<Point> squares;
+        for (int x = left; x < left + base; x++) {
+            for (int y = bottom; y < bottom + height; y++) {
+                if (covers_whole_square(candidate, 0, x, y)) squares.push_back(Point(x, y));
+            }
+        }
+        if (squares.empty()) continue;
+
+        Point square = squares[random.below(squares.size())];
+        placed.push_back(candidate._ax[0], candidate._ay[0], candidate._bx[0], candidate._by[0], candidate._cx[0],
+                         candidate._cy[0]);
+        chosen.push_back(clue{area, square.x, square.y});
+    }
+
+    std::sort(chosen.begin(), chosen.end(), [](const clue& a, const clue& b) {
+        return a.y != b.y ? a.y < b.y : a.x < b.x;
+    });
+
+    puzzle generated{size, size, {}};
+    for (const auto& c : chosen) {
+        generated._board.emplace_back(c.area, c.x, c.y, size, size);
+    }
+    return generated;
+}
+
+////////////////////////////////////
+//           Timing               //
+////////////////////////////////////
+
+struct phase_times {
+    vector<double> seconds;
+
+    double min() const { return *std::min_element(seconds.begin(), seconds.end()); }
+    double median() const {
+        vector<double> sorted = seconds;
+        std::sort(sorted.begin(), sorted.end());
+        return sorted[sorted.size() / 2];
+    }
+};
+
+// Run `phase` `repeat` times and record how long each run took.
+template <typename Phase>
+phase_times time_phase(int repeat, Phase phase) {
+    phase_times times;
+    for (int i{}; i < repeat; i++) {
+        auto start = std::chrono::steady_clock::now();
+        phase();
+        times.seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return times;
+}
+
+/*
+ *  Run the search, raising its stop flag if it is still going after time_limit seconds.
+ *  Returns "solved", "unsolved" (the whole tree was searched) or "timeout".
+ */
+
+std::string timed_solution(const vector<Triangle>& board, const conflict_matrix& conflicts, int threads,
+                           double time_limit) {
+    std::atomic<bool> stop(false);
+    std::mutex mutex;
+    std::condition_variable finished;
+    bool done = false;
+
+    std::thread watchdog([&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!finished.wait_for(lock, std::chrono::duration<double>(time_limit), [&]() { return done; })) {
+            stop.store(true);
+        }
+    });
+
+    search_options options;
+    options.threads = threads;
+    options.stop = &stop;
+
+    vector<int> solution_ids;
+    bool found = parallel_solution(board, conflicts, options, solution_ids);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    finished.notify_one();
+    watchdog.join();
+
+    if (found) return "solved";
+    return stop.load() ? "timeout" : "unsolved";
+}
+
+void report(const std::string& instance, const puzzle& timed, uint64_t seed, int candidates, const std::string& phase,
+            const phase_times& times, const std::string& status = "") {
+    std::ostringstream line;
+    line.precision(9);
+    line << std::fixed;
+    line << "{\"instance\":\"" << instance << "\",\"width\":" << timed._width << ",\"height\":" << timed._height
+         << ",\"clues\":" << timed._board.size() << ",\"seed\":" << seed << ",\"candidates\":" << candidates
+         << ",\"phase\":\"" << phase << "\",\"repeat\":" << times.seconds.size()
+         << ",\"seconds_min\":" << times.min() << ",\"seconds_median\":" << times.median();
+    if (!status.empty()) line << ",\"status\":\"" << status << "\"";
+    line << "}\n";
+    cout << line.str() << std::flush;
+}
+
+void benchmark(const std::string& instance, const puzzle& timed, uint64_t seed, int threads, int repeat,
+               double time_limit) {
+    const vector<Triangle>& clues = timed._board;
+
+    vector<vector<valid_translations>> combinations(clues.size());
+    phase_times dimensions = time_phase(repeat, [&]() {
+        for (int i{}; i < clues.size(); i++) {
+            combinations[i].clear();
+            Triangle::create_dimensions(clues[i].getArea(), combinations[i]);
+        }
+    });
+
+    vector<vector<Point>> shapes(clues.size());
+    phase_times orientations = time_phase(repeat, [&]() {
+        for (int i{}; i < clues.size(); i++) {
+            shapes[i].clear();
+            Triangle::make_shapes(combinations[i], shapes[i]);
+        }
+    });
+
+    // make_combinations is a member, so it is called on copies of the already built clues.
+    vector<Triangle> scratch = clues;
+    phase_times placements = time_phase(repeat, [&]() {
+        for (int i{}; i < clues.size(); i++) {
+            scratch[i].all_triangles.clear();
+            scratch[i].make_combinations(clues[i].getXC(), clues[i].getYC(), clues[i].getWidth(), clues[i].getHeight(),
+                                         shape_template_for(clues[i].getArea())._shapes, scratch[i].all_triangles);
+        }
+    });
+
+    phase_times building = time_phase(repeat, [&]() {
+        vector<Triangle> built;
+        built.reserve(clues.size());
+        for (const auto& clue : clues) {
+            built.emplace_back(clue.getArea(), clue.getXC(), clue.getYC(), clue.getWidth(), clue.getHeight());
+        }
+    });
+
+    vector<Triangle> board;
+    phase_times preprocessing = time_phase(repeat, [&]() {
+        board = clues;
+        pre_process_valid_triangles(board);
+    });
+
+    conflict_matrix conflicts;
+    phase_times matrix = time_phase(repeat, [&]() { conflicts = build_conflict_matrix(board); });
+    int matrix_candidates = conflicts._total;
+
+    vector<Triangle> consistent;
+    conflict_matrix propagated;
+    phase_times propagation = time_phase(repeat, [&]() {
+        consistent = board;
+        propagated = conflicts;
+        propagate_arc_consistency(consistent, propagated);
+    });
+
+    vector<Triangle> ordered;
+    conflict_matrix reordered;
+    phase_times ordering = time_phase(repeat, [&]() {
+        ordered = consistent;
+        reordered = propagated;
+        order_least_constraining(ordered, reordered);
+    });
+
+    std::string status;
+    phase_times search;
+    for (int i{}; i < repeat && status != "timeout"; i++) {
+        auto start = std::chrono::steady_clock::now();
+        status = timed_solution(ordered, reordered, threads, time_limit);
+        search.seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    search_options options;
+    options.threads = threads;
+    phase_times whole, batch;
+    if (status != "timeout") {
+        puzzle_solver solver(options);
+        solve_result result;
+        whole = time_phase(repeat, [&]() { solver.solve(timed, result); });
+
+        batch_solver pool(threads);
+        vector<puzzle> copies(threads, timed);
+        vector<solve_result> results;
+        batch = time_phase(repeat, [&]() { pool.solve(copies, results); });
+    }
+
+    int raw = 0;
+    for (const auto& triangle : clues) raw += triangle.all_triangles.size();
+
+    report(instance, timed, seed, raw, "create_dimensions", dimensions);
+    report(instance, timed, seed, raw, "make_shapes", orientations);
+    report(instance, timed, seed, raw, "make_combinations", placements);
+    report(instance, timed, seed, raw, "build_board", building);
+    report(instance, timed, seed, raw, "pre_process_valid_triangles", preprocessing);
+    report(instance, timed, seed, matrix_candidates, "build_conflict_matrix", matrix);
+    report(instance, timed, seed, matrix_candidates, "propagate_arc_consistency", propagation);
+    report(instance, timed, seed, propagated._total, "order_least_constraining", ordering);
+    report(instance, timed, seed, propagated._total, "solution", search, status);
+    if (status != "timeout") {
+        report(instance, timed, seed, raw, "puzzle_solver", whole);
+        report(instance, timed, seed, raw, "batch_solver", batch);
+    }
+}
+
+/*
+ *  Usage: TriTriBenchmark [--threads N] [--repeat R] [--time-limit SECONDS] [--seed S] [--max-size N]
+ *
+ *  Benchmarks the published puzzle, then generated puzzles from 16 by 16 up to 64 by 64 with 200 clues (stopping
+ *  after --max-size). --seed picks the generated puzzles; the same seed always gives the same puzzles.
+ */
+
+int main(int argc, char* argv[]) {
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    int repeat = 5;
+    double time_limit = 10;
+    uint64_t seed = 1;
+    int max_size = 64;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--time-limit" && i + 1 < argc) {
+            time_limit = std::atof(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--max-size" && i + 1 < argc) {
+            max_size = std::atoi(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--threads N] [--repeat R] [--time-limit SECONDS] [--seed S] [--max-size N]\n";
+            return 2;
+        }
+    }
+
+    benchmark("published", published_puzzle(), 0, threads, repeat, time_limit);
+
+    // (board size, clues) for the generated puzzles, roughly keeping the published puzzle's density.
+    const int sizes[][2] = { {16, 25}, {24, 50}, {32, 80}, {48, 130}, {64, 200} };
+    for (const auto& size : sizes) {
+        if (size[0] > max_size) break;
+        std::string instance = "generated-" + std::to_string(size[0]) + "x" + std::to_string(size[0]) + "-" +
+                               std::to_string(size[1]);
+        benchmark(instance, generate_puzzle(size[0], size[1], seed), seed, threads, repeat, time_limit);
+    }
+
+    return 0;
+}
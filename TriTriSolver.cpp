@@ -0,0 +1,2982 @@
+#include "TriTriSolver.h"
+
+#include <iostream>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <sstream>
+#include <limits>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <random>
+#include <utility>
+#include <unordered_set>
+#include <fstream>
+#include <cstdio>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define TRI_TRI_AVX2_KERNEL
+#endif
+
+namespace tritri {
+
+using std::cout;
+using std::vector;
+
+/* Calculate all valid integer base/height combinations given
+ * the triangle's area. Do so by imagining the triangle is a square.
+ *
+ * A base must be at least 2 squares wide, otherwise, the 1 by 1 square
+ * representing that triangle's area cannot fit in it.
+ */
+
+void Triangle::create_dimensions(int area, vector<valid_translations>& combinations) {
+    int effectiveArea = 2 * area;
+
+    for (int base{2}; base < effectiveArea; ++base) {
+        int height;
+        if (effectiveArea % base == 0) {
+            height = effectiveArea / base;
+            combinations.push_back(valid_translations(Point(base, height), translate(Point(base, height))));
+        }
+    }
+    return;
+}
+
+vector<Point> Triangle::translate(Point dimensions) {
+    
+    vector<Point> results;
+
+    int shiftY{}, shiftX{};
+    
+    /*
+     * The box that our triangle contains is size 1 by 1
+     */
+
+    Point q1(1,1); 
+
+    // The three vertices of our triangle.
+    Point v1(shiftX,shiftY); 
+    Point v2(0, dimensions.y);
+    Point v3(dimensions.x, 0);
+
+    int maxHeight = dimensions.y;
+    while (is_inside_triangle(q1,v1,v2,v3)) {
+        shiftY = 0;
+        v1.x = shiftX;
+        v1.y = shiftY;
+        while (is_inside_triangle(q1,v1,v2,v3)) {
+            results.push_back(Point(shiftX, shiftY));
+            shiftY--;
+            v2.y--;
+            v3.y--;
+        }
+        v2.y = maxHeight;
+        v2.x--;
+        v3.y = 0;
+        v3.x--;
+        shiftX--;
+    }
+   return results;
+}
+
+/* Having a vector that contains all the possible dimensions and translations (offsets) to these
+ * dimensions, we can print out each base/height and shift combination.
+ *
+ */
+
+void Triangle::print_dimensions() const {
+    for (const auto& j : _shape->_combinations) {
+        cout << j._dimensions.x << " " << j._dimensions.y << " = ";
+        for (int i{}; i < j._translations.size(); i++) {
+            cout << j._translations[i].x << ' ' << j._translations[i].y << ' ';
+        }
+        cout << "\n";
+    }
+    return;
+}
+
+/*
+ *  All our base/height and shift combinations apply to a triangle that is upright. make_shapes lays each of them
+ *  over the square in the first `Orientations` entries of dihedral_transforms, one orientation after another.
+ *
+ *  The vector shapes will contain three vertices for each way of laying the triangle over its square, with
+ *  the square at (0, 0) and no board around it to fall off: the right angle, then the end of the base, then the
+ *  top. They depend only on the area, so they're worked out once per area (see shape_template_for) and
+ *  make_combinations moves them onto each clue.
+ *
+ *  Each orientation is an instantiation of its own, so the transform is a constant in the loop over the shapes.
+ */
+
+namespace {
+
+template <int Orientation>
+void make_oriented_shapes(const vector<valid_translations>& combinations, vector<Point>& shapes) {
+    constexpr dihedral_transform turn = dihedral_transforms[Orientation];
+
+    for (const valid_translations& combination : combinations) {
+        int base = combination._dimensions.x, height = combination._dimensions.y;
+        for (Point a : combination._translations) {
+            shapes.push_back(turn.apply(a));
+            shapes.push_back(turn.apply(Point(a.x + base, a.y)));
+            shapes.push_back(turn.apply(Point(a.x, a.y + height)));
+        }
+    }
+}
+
+template <int... Orientation>
+void make_shapes_in(const vector<valid_translations>& combinations, vector<Point>& shapes,
+                    std::integer_sequence<int, Orientation...>) {
+    (make_oriented_shapes<Orientation>(combinations, shapes), ...);
+}
+
+}
+
+template <int Orientations>
+void Triangle::make_shapes(const vector<valid_translations>& combinations, vector<Point>& shapes) {
+    static_assert(Orientations >= 1 && Orientations <= dihedral_count, "there are eight orientations");
+    make_shapes_in(combinations, shapes, std::make_integer_sequence<int, Orientations>());
+}
+
+template void Triangle::make_shapes<rotation_count>(const vector<valid_translations>&, vector<Point>&);
+template void Triangle::make_shapes<dihedral_count>(const vector<valid_translations>&, vector<Point>&);
+
+/*
+ *  Anchor the shapes on the clue's square (X, Y) and keep the ones that stay on the board. all_triangles
+ *  will contain a record for each valid triangle placement on our board.
+ *
+ *  A board of width by height squares has vertices running from 0 to width and 0 to height. The common board
+ *  sizes get their own copy of the loop below with the size as a constant (Width, Height), so the bounds
+ *  checks fold down; every other size passes 0 and checks against the runtime width and height instead.
+ *
+ *  Two shapes can land on the same triangle, so each placement's placement_key goes in a hash set, and a placement
+ *  whose key is already there is dropped and counted in _duplicates. A duplicate would otherwise have the search
+ *  go through everything below it twice.
+ */
+
+void Triangle::make_combinations(int X, int Y, int width, int height, const vector<Point>& shapes,
+                                 placement_list& allTriangles) {
+    if (width == 17 && height == 17) {
+        _duplicates = make_combinations_on<17, 17>(X, Y, width, height, shapes, allTriangles);
+    } else if (width == 32 && height == 32) {
+        _duplicates = make_combinations_on<32, 32>(X, Y, width, height, shapes, allTriangles);
+    } else if (width == 64 && height == 64) {
+        _duplicates = make_combinations_on<64, 64>(X, Y, width, height, shapes, allTriangles);
+    } else {
+        _duplicates = make_combinations_on<0, 0>(X, Y, width, height, shapes, allTriangles);
+    }
+    return;
+}
+
+template <int Width, int Height>
+int Triangle::make_combinations_on(int X, int Y, int width, int height, const vector<Point>& shapes,
+                                   placement_list& allTriangles) {
+    const unsigned maxX = Width ? Width : width;
+    const unsigned maxY = Height ? Height : height;
+    std::unordered_set<uint64_t> seen(shapes.size() / 3);
+    int duplicates = 0;
+    for (int i{}; i < shapes.size(); i += 3) {
+        int aX = X + shapes[i].x, aY = Y + shapes[i].y;
+        int bX = X + shapes[i+1].x, bY = Y + shapes[i+1].y;
+        int cX = X + shapes[i+2].x, cY = Y + shapes[i+2].y;
+
+        // The points must lie on the board. As unsigned, a coordinate below 0 is past the far edge too, so it's one
+        // comparison each, and they're combined without branching.
+
+        bool on_board = (unsigned(aX) <= maxX) & (unsigned(bX) <= maxX) & (unsigned(cX) <= maxX) &
+                        (unsigned(aY) <= maxY) & (unsigned(bY) <= maxY) & (unsigned(cY) <= maxY);
+        if (!on_board) continue;
+
+        if (seen.insert(placement_key(aX, aY, bX, bY, cX, cY)).second) {
+            allTriangles.push_back(aX, aY, bX, bY, cX, cY);
+        } else {
+            duplicates++;
+        }
+    }
+    return duplicates;
+}
+
+void placement_list::push_back(int ax, int ay, int bx, int by, int cx, int cy) {
+    _ax.push_back(ax);
+    _ay.push_back(ay);
+    _bx.push_back(bx);
+    _by.push_back(by);
+    _cx.push_back(cx);
+    _cy.push_back(cy);
+}
+
+/*
+ *  A key that two placements share exactly when they are the same triangle, whichever order their vertices come
+ *  in. Every placement is a right angle triangle with its legs along the axes, so it is pinned down by four numbers:
+ *  the right angle's x and y, the x at the end of the leg along the x axis, and the y at the end of the other one.
+ *  Those are on the board, and so fit in 16 bits each (see placement_list).
+ */
+
+uint64_t placement_key(int ax, int ay, int bx, int by, int cx, int cy) {
+    Point corners[3] = {Point(ax, ay), Point(bx, by), Point(cx, cy)};
+    // The right angle is the corner that shares its x with one of the others and its y with the other.
+    int r = 0;
+    for (; r < 2; r++) {
+        Point p = corners[r], q = corners[(r + 1) % 3], s = corners[(r + 2) % 3];
+        if ((p.x == q.x && p.y == s.y) || (p.y == q.y && p.x == s.x)) break;
+    }
+    Point right = corners[r], along = corners[(r + 1) % 3], up = corners[(r + 2) % 3];
+    if (along.y != right.y) std::swap(along, up);
+    return uint64_t(uint16_t(right.x)) | uint64_t(uint16_t(right.y)) << 16 | uint64_t(uint16_t(along.x)) << 32 |
+           uint64_t(uint16_t(up.y)) << 48;
+}
+
+void placement_list::clear() {
+    for (auto* coordinate : {&_ax, &_ay, &_bx, &_by, &_cx, &_cy}) coordinate->clear();
+}
+
+void placement_list::compact(const vector<char>& keep) {
+    for (auto* coordinate : {&_ax, &_ay, &_bx, &_by, &_cx, &_cy}) {
+        int kept = 0;
+        for (int i{}; i < coordinate->size(); i++) {
+            if (keep[i]) (*coordinate)[kept++] = (*coordinate)[i];
+        }
+        coordinate->resize(kept);
+    }
+}
+
+void placement_list::select(const vector<int>& indices) {
+    for (auto* coordinate : {&_ax, &_ay, &_bx, &_by, &_cx, &_cy}) {
+        vector<int16_t> chosen(indices.size());
+        for (int i{}; i < indices.size(); i++) chosen[i] = (*coordinate)[indices[i]];
+        coordinate->swap(chosen);
+    }
+}
+
+/*
+ *  The process-wide cache behind shape_template_for. Entries are never removed, so the references it
+ *  hands out stay good for the life of the program.
+ */
+
+const shape_template& shape_template_for(int area) {
+    static std::mutex mutex;
+    static std::map<int, std::unique_ptr<shape_template>> templates;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<shape_template>& shape = templates[area];
+    if (!shape) {
+        shape.reset(new shape_template);
+        Triangle::create_dimensions(area, shape->_combinations);
+        Triangle::make_shapes(shape->_combinations, shape->_shapes);
+    }
+    return *shape;
+}
+
+/*
+ * Print the contents of all_triangles, one triangle per line.
+ */
+
+
+void Triangle::print_triangles() const {
+    for (int i{}; i < all_triangles.size();i++) {
+        for (Point vertex : {all_triangles.a(i), all_triangles.b(i), all_triangles.c(i)}) {
+            cout << "( " << vertex.x << " " << vertex.y << " ) |";
+        }
+        cout << "\n";
+    }
+    cout << "\n";
+    return;
+}
+
+////////////////////////////////////
+//   Point Comparison Functions   //
+////////////////////////////////////
+
+// Determines whether a point lies on another line.
+
+bool is_on_same_line(Point p, Point q, Point r) { 
+    if (q.x <= std::max(p.x, r.x) && q.x >= std::min(p.x, r.x) && 
+        q.y <= std::max(p.y, r.y) && q.y >= std::min(p.y, r.y)) {
+            return true; 
+        }
+    return false; 
+} 
+  
+
+
+int orientation(Point p, Point q, Point r) { 
+
+    int val = (q.y - p.y) * (r.x - q.x) - 
+              (q.x - p.x) * (r.y - q.y); 
+    
+    // Co-linear
+    if (val == 0) return 0;  
+    // Non-colinear (1 = clockwise, 2 = counterclock wise) 
+    return (val > 0) ? 1 : 2; 
+} 
+
+bool do_intersect(Point p1, Point q1, Point p2, Point q2) { 
+    // Find the four orientations needed for general and special cases 
+    int o1 = orientation(p1, q1, p2); 
+    int o2 = orientation(p1, q1, q2); 
+    int o3 = orientation(p2, q2, p1); 
+    int o4 = orientation(p2, q2, q1); 
+
+    // If the tips (vertices) of a triangle touch, we consider it as NOT
+    // crossing. 
+    if (o1 == 0 || o2 == 0 || o3 == 0 || o4 == 0) return false;
+
+    // General case 
+    if (o1 != o2 && o3 != o4) 
+        return true; 
+  
+    // Special Cases 
+    // p1, q1 and p2 are colinear and p2 lies on segment p1q1 
+    if (o1 == 0 && is_on_same_line(p1, p2, q1)) return false;  
+  
+    // p1, q1 and q2 are colinear and q2 lies on segment p1q1 
+    if (o2 == 0 && is_on_same_line(p1, q2, q1)) return false; 
+  
+    // p2, q2 and p1 are colinear and p1 lies on segment p2q2 
+    if (o3 == 0 && is_on_same_line(p2, p1, q2)) return false; 
+  
+     // p2, q2 and q1 are colinear and q1 lies on segment p2q2 
+    if (o4 == 0 && is_on_same_line(p2, q1, q2)) return false; 
+  
+    return false; // Doesn't fall in any of the above cases 
+} 
+
+int sign (Point p1, Point p2, Point p3) {
+    return (p1.x - p3.x) * (p2.y - p3.y) - (p2.x - p3.x) * (p1.y - p3.y);
+}
+
+/*
+ * Given a point of interest, pt, find out whether or not it lies in 
+ * a triangle with vertices v1, v2, and v3.
+ */
+
+bool is_inside_triangle (Point pt, Point v1, Point v2, Point v3) {
+    int d1, d2, d3;
+    bool has_neg, has_pos;
+
+    d1 = sign(pt, v1, v2);
+    d2 = sign(pt, v2, v3);
+    d3 = sign(pt, v3, v1);
+
+    has_neg = (d1 < 0) || (d2 < 0) || (d3 < 0);
+    has_pos = (d1 > 0) || (d2 > 0) || (d3 > 0);
+
+    return !(has_neg && has_pos);
+}
+/*
+ * Given a vector of valid triangles, figure out whether another triangle is contained within it
+ */
+
+
+bool is_triangle_contained_in_another_triangle(vector<Point>& triangle_vertices, Point p, Point q, Point r) { 
+    for (int i{}; i < triangle_vertices.size(); i += 3) {
+        if (is_inside_triangle(p,triangle_vertices[i],triangle_vertices[i+1],triangle_vertices[i+2]) &&
+            is_inside_triangle(q,triangle_vertices[i],triangle_vertices[i+1],triangle_vertices[i+2]) && 
+            is_inside_triangle(r,triangle_vertices[i],triangle_vertices[i+1],triangle_vertices[i+2])) return true;
+    }
+    return false;
+}
+
+/*
+ * Given a vector of valid triangles and three points, find out whether a point from the vector lies within these three points.
+ */
+
+bool triangle_contains_another_triangle(vector<Point>& triangle_vertices, Point p, Point q, Point r) {
+    for (int i{}; i < triangle_vertices.size(); i += 3) {
+        Point vertex_1(triangle_vertices[i].x,triangle_vertices[i].y);
+        Point vertex_2(triangle_vertices[i+1].x, triangle_vertices[i+1].y);
+        Point vertex_3(triangle_vertices[i+2].x, triangle_vertices[i+2].y);
+
+        if (is_inside_triangle(vertex_1, p, q, r) &&
+            is_inside_triangle(vertex_2, p, q, r) && 
+            is_inside_triangle(vertex_3, p, q, r)) return true;
+            
+    }
+    return false;
+}
+
+
+// Twice the signed area of (o, u, v), positive when they turn anticlockwise. Exact, as the coordinates are whole numbers.
+
+long long turn(Point o, Point u, Point v) {
+    long long ux = (long long)u.x - (long long)o.x, uy = (long long)u.y - (long long)o.y;
+    long long vx = (long long)v.x - (long long)o.x, vy = (long long)v.y - (long long)o.y;
+    return ux * vy - uy * vx;
+}
+
+namespace {
+
+// True if every one of `points` is on the far side of edge (u, v) of a triangle whose third vertex is w, or on the edge.
+bool separates(Point u, Point v, Point w, const Point* points, int count) {
+    long long inside = turn(u, v, w);
+    for (int i{}; i < count; i++) {
+        long long side = turn(u, v, points[i]);
+        if ((inside > 0 && side > 0) || (inside < 0 && side < 0)) return false;
+    }
+    return true;
+}
+
+}
+
+/*
+ *  The full overlap test between placement i of `mine` and placement j of `theirs`: true if they share any area.
+ *  Touching along an edge or at a corner is fine.
+ *
+ *  Two convex shapes are apart exactly when some edge of one has all of the other on its far side (or on the
+ *  edge itself), so that's six checks, all done in whole numbers. Bounding boxes that don't overlap (touching
+ *  is fine) rule most pairs on the board out before that.
+ */
+
+bool placements_conflict(const placement_list& mine, int i, const placement_list& theirs, int j) {
+    if (std::max({mine._ax[i], mine._bx[i], mine._cx[i]}) <= std::min({theirs._ax[j], theirs._bx[j], theirs._cx[j]}) ||
+        std::max({theirs._ax[j], theirs._bx[j], theirs._cx[j]}) <= std::min({mine._ax[i], mine._bx[i], mine._cx[i]}) ||
+        std::max({mine._ay[i], mine._by[i], mine._cy[i]}) <= std::min({theirs._ay[j], theirs._by[j], theirs._cy[j]}) ||
+        std::max({theirs._ay[j], theirs._by[j], theirs._cy[j]}) <= std::min({mine._ay[i], mine._by[i], mine._cy[i]})) {
+        return false;
+    }
+
+    Point p = mine.a(i), q = mine.b(i), r = mine.c(i);
+    Point a = theirs.a(j), b = theirs.b(j), c = theirs.c(j);
+    const Point first[] = {p, q, r};
+    const Point second[] = {a, b, c};
+    return !separates(p, q, r, second, 3) && !separates(q, r, p, second, 3) && !separates(r, p, q, second, 3) &&
+           !separates(a, b, c, first, 3) && !separates(b, c, a, first, 3) && !separates(c, a, b, first, 3);
+}
+
+/*
+ *  Put the index of every placement in `theirs` that conflicts with placement i of `mine` in `hits`, in order.
+ *
+ *  On a CPU with AVX2, eight of `theirs` are tested at a time, a 32-bit lane each, with every turn worked out for all
+ *  of them and no branches: first the bounding boxes, then the six edges. Turning every triangle anticlockwise up
+ *  front (by swapping its last two vertices where needed) means an edge separates when the other triangle's three
+ *  turns against it are all <= 0. The turns fit in 32 bits because read_puzzle keeps coordinates inside int16_t.
+ *  Otherwise, and for the last few placements of the list, it's placements_conflict one pair at a time.
+ *
+ *  Only build_conflict_matrix and puzzle_session::pair_up call this. The search itself tests no geometry: a candidate
+ *  is checked against what's placed by conflict_matrix rows and placement_bitboards, which this kernel doesn't touch.
+ */
+
+namespace {
+
+void placements_conflicting_scalar(const placement_list& mine, int i, const placement_list& theirs, int from,
+                                   vector<int>& hits) {
+    for (int j = from; j < theirs.size(); j++) {
+        if (placements_conflict(mine, i, theirs, j)) hits.push_back(j);
+    }
+}
+
+#ifdef TRI_TRI_AVX2_KERNEL
+
+// (u - o) x (v - o) in every lane.
+__attribute__((target("avx2")))
+inline __m256i turn_8(__m256i ox, __m256i oy, __m256i ux, __m256i uy, __m256i vx, __m256i vy) {
+    return _mm256_sub_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(ux, ox), _mm256_sub_epi32(vy, oy)),
+                            _mm256_mullo_epi32(_mm256_sub_epi32(uy, oy), _mm256_sub_epi32(vx, ox)));
+}
+
+// Lanes where edge (u, v) of an anticlockwise triangle has some of the triangle (x, y) strictly on its inside.
+__attribute__((target("avx2")))
+inline __m256i inside_8(__m256i ux, __m256i uy, __m256i vx, __m256i vy, const __m256i* x, const __m256i* y) {
+    __m256i most = _mm256_max_epi32(turn_8(ux, uy, vx, vy, x[0], y[0]),
+                                    _mm256_max_epi32(turn_8(ux, uy, vx, vy, x[1], y[1]), turn_8(ux, uy, vx, vy, x[2], y[2])));
+    return _mm256_cmpgt_epi32(most, _mm256_setzero_si256());
+}
+
+// Eight int16_t coordinates from `coordinate`, starting at j, widened to 32 bits.
+__attribute__((target("avx2")))
+inline __m256i load_8(const vector<int16_t>& coordinate, int j) {
+    return _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&coordinate[j])));
+}
+
+__attribute__((target("avx2")))
+void placements_conflicting_avx2(const placement_list& mine, int i, const placement_list& theirs, vector<int>& hits) {
+    __m256i left = _mm256_set1_epi32(std::min({mine._ax[i], mine._bx[i], mine._cx[i]}));
+    __m256i right = _mm256_set1_epi32(std::max({mine._ax[i], mine._bx[i], mine._cx[i]}));
+    __m256i bottom = _mm256_set1_epi32(std::min({mine._ay[i], mine._by[i], mine._cy[i]}));
+    __m256i top = _mm256_set1_epi32(std::max({mine._ay[i], mine._by[i], mine._cy[i]}));
+
+    Point p = mine.a(i), q = mine.b(i), r = mine.c(i);
+    if (turn(p, q, r) < 0) std::swap(q, r);
+    const __m256i mine_x[] = {_mm256_set1_epi32(p.x), _mm256_set1_epi32(q.x), _mm256_set1_epi32(r.x)};
+    const __m256i mine_y[] = {_mm256_set1_epi32(p.y), _mm256_set1_epi32(q.y), _mm256_set1_epi32(r.y)};
+
+    int j = 0;
+    for (; j + 8 <= theirs.size(); j += 8) {
+        __m256i ax = load_8(theirs._ax, j), ay = load_8(theirs._ay, j);
+        __m256i bx = load_8(theirs._bx, j), by = load_8(theirs._by, j);
+        __m256i cx = load_8(theirs._cx, j), cy = load_8(theirs._cy, j);
+
+        __m256i boxes = _mm256_and_si256(
+            _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_max_epi32(ax, _mm256_max_epi32(bx, cx)), left),
+                             _mm256_cmpgt_epi32(right, _mm256_min_epi32(ax, _mm256_min_epi32(bx, cx)))),
+            _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_max_epi32(ay, _mm256_max_epi32(by, cy)), bottom),
+                             _mm256_cmpgt_epi32(top, _mm256_min_epi32(ay, _mm256_min_epi32(by, cy)))));
+        if (_mm256_testz_si256(boxes, boxes)) continue;
+
+        __m256i clockwise = _mm256_cmpgt_epi32(_mm256_setzero_si256(), turn_8(ax, ay, bx, by, cx, cy));
+        const __m256i theirs_x[] = {ax, _mm256_blendv_epi8(bx, cx, clockwise), _mm256_blendv_epi8(cx, bx, clockwise)};
+        const __m256i theirs_y[] = {ay, _mm256_blendv_epi8(by, cy, clockwise), _mm256_blendv_epi8(cy, by, clockwise)};
+
+        __m256i conflicts = boxes;
+        for (int e{}; e < 3; e++) {
+            int f = (e + 1) % 3;
+            conflicts = _mm256_and_si256(conflicts, inside_8(mine_x[e], mine_y[e], mine_x[f], mine_y[f], theirs_x, theirs_y));
+            conflicts = _mm256_and_si256(conflicts, inside_8(theirs_x[e], theirs_y[e], theirs_x[f], theirs_y[f], mine_x, mine_y));
+        }
+        for (unsigned lanes = _mm256_movemask_ps(_mm256_castsi256_ps(conflicts)); lanes; lanes &= lanes - 1) {
+            hits.push_back(j + __builtin_ctz(lanes));
+        }
+    }
+    placements_conflicting_scalar(mine, i, theirs, j, hits);
+}
+
+#endif
+
+}
+
+void placements_conflicting(const placement_list& mine, int i, const placement_list& theirs, vector<int>& hits) {
+    hits.clear();
+#ifdef TRI_TRI_AVX2_KERNEL
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if (avx2) return placements_conflicting_avx2(mine, i, theirs, hits);
+#endif
+    placements_conflicting_scalar(mine, i, theirs, 0, hits);
+}
+
+/*
+ *  Whether placement i covers some part of the square with bottom left corner (x, y), and whether it covers all of
+ *  it. A square outside the placement's bounding box can only touch it. Inside the box the square's own edges can't
+ *  separate the two, so it comes down to the placement's edges; and the placement is convex, so it covers the
+ *  whole square when it has all four corners.
+ */
+
+bool covers_square(const placement_list& placements, int i, int x, int y) {
+    if (x < std::min({placements._ax[i], placements._bx[i], placements._cx[i]}) ||
+        x >= std::max({placements._ax[i], placements._bx[i], placements._cx[i]}) ||
+        y < std::min({placements._ay[i], placements._by[i], placements._cy[i]}) ||
+        y >= std::max({placements._ay[i], placements._by[i], placements._cy[i]})) {
+        return false;
+    }
+
+    Point p = placements.a(i), q = placements.b(i), r = placements.c(i);
+    const Point corners[] = {Point(x, y), Point(x + 1, y), Point(x, y + 1), Point(x + 1, y + 1)};
+    return !separates(p, q, r, corners, 4) && !separates(q, r, p, corners, 4) && !separates(r, p, q, corners, 4);
+}
+
+bool covers_whole_square(const placement_list& placements, int i, int x, int y) {
+    Point p = placements.a(i), q = placements.b(i), r = placements.c(i);
+    long long pq = turn(p, q, r), qr = turn(q, r, p), rp = turn(r, p, q);
+    for (Point corner : {Point(x, y), Point(x + 1, y), Point(x, y + 1), Point(x + 1, y + 1)}) {
+        if (turn(p, q, corner) * pq < 0 || turn(q, r, corner) * qr < 0 || turn(r, p, corner) * rp < 0) return false;
+    }
+    return true;
+}
+
+/*
+ *  Which of the ways two placements can conflict applies to placement i of `mine` and placement j of `theirs`.
+ *  Only meaningful for a pair that does conflict.
+ */
+
+prune_reason conflict_reason(const placement_list& mine, int i, const placement_list& theirs, int j) {
+    Point p = mine.a(i), q = mine.b(i), r = mine.c(i);
+    Point a = theirs.a(j), b = theirs.b(j), c = theirs.c(j);
+
+    if (do_intersect(p, q, a, b) || do_intersect(p, q, a, c) || do_intersect(p, q, c, b) ||
+        do_intersect(p, r, a, b) || do_intersect(p, r, a, c) || do_intersect(p, r, c, b) ||
+        do_intersect(q, r, a, b) || do_intersect(q, r, a, c) || do_intersect(q, r, c, b)) {
+        return prune_edge_crossing;
+    }
+    if (is_inside_triangle(p, a, b, c) && is_inside_triangle(q, a, b, c) && is_inside_triangle(r, a, b, c)) {
+        return prune_contained_in;
+    }
+    if (is_inside_triangle(a, p, q, r) && is_inside_triangle(b, p, q, r) && is_inside_triangle(c, p, q, r)) {
+        return prune_contains;
+    }
+    return prune_edge_crossing;
+}
+
+////////////////////////////////////
+//           Bitboards            //
+////////////////////////////////////
+
+/*
+ *  Rasterise every candidate of every triangle on the board, with covers_square and covers_whole_square.
+ */
+
+placement_bitboards rasterise_placements(const vector<Triangle>& board) {
+    placement_bitboards boards;
+    rasterise_placements(board, boards);
+    return boards;
+}
+
+// As above, into `boards`, which keeps its memory for the new placements.
+void rasterise_placements(const vector<Triangle>& board, placement_bitboards& boards) {
+    boards.clear(board.empty() ? 0 : board[0].getHeight(), board.empty() ? 0 : (board[0].getWidth() + 63) / 64);
+
+    for (const auto& triangle : board) {
+        const placement_list& all = triangle.all_triangles;
+        for (int j{}; j < all.size(); j++) {
+            int left = std::min({all._ax[j], all._bx[j], all._cx[j]}), right = std::max({all._ax[j], all._bx[j], all._cx[j]});
+            int bottom = std::min({all._ay[j], all._by[j], all._cy[j]}), top = std::max({all._ay[j], all._by[j], all._cy[j]});
+
+            boards._left.push_back(left);
+            boards._right.push_back(right);
+            boards._bottom.push_back(bottom);
+            boards._top.push_back(top);
+            boards._offset.push_back(boards._interior.size());
+            boards._interior.resize(boards._interior.size() + size_t(top - bottom) * boards._row_words, 0);
+            boards._covered.resize(boards._covered.size() + size_t(top - bottom) * boards._row_words, 0);
+
+            uint64_t* interior = &boards._interior[boards._offset.back()];
+            uint64_t* covered = &boards._covered[boards._offset.back()];
+            for (int y = bottom; y < top; y++) {
+                for (int x = left; x < right; x++) {
+                    if (!covers_square(all, j, x, y)) continue;
+
+                    uint64_t bit = uint64_t(1) << (x % 64);
+                    size_t word = size_t(y - bottom) * boards._row_words + x / 64;
+                    covered[word] |= bit;
+                    if (covers_whole_square(all, j, x, y)) interior[word] |= bit;
+                }
+            }
+        }
+    }
+}
+
+int placement_bitboards::compare_occupied(int id, const uint64_t* interior, const uint64_t* covered) const {
+    const uint64_t* mine_interior = &_interior[_offset[id]];
+    const uint64_t* mine_covered = &_covered[_offset[id]];
+    interior += size_t(_bottom[id]) * _row_words;
+    covered += size_t(_bottom[id]) * _row_words;
+
+    uint64_t certain = 0, shared = 0;
+    for (int w{}; w < (_top[id] - _bottom[id]) * _row_words; w++) {
+        certain |= (mine_interior[w] & covered[w]) | (mine_covered[w] & interior[w]);
+        shared |= mine_covered[w] & covered[w];
+    }
+    if (certain) return 1;
+    return shared ? -1 : 0;
+}
+
+void placement_bitboards::clear(int height, int row_words) {
+    for (vector<int>* column : {&_left, &_right, &_bottom, &_top, &_offset}) column->clear();
+    _interior.clear();
+    _covered.clear();
+    _height = height;
+    _row_words = row_words;
+}
+
+void placement_bitboards::append(const placement_bitboards& from, int id) {
+    _left.push_back(from._left[id]);
+    _right.push_back(from._right[id]);
+    _bottom.push_back(from._bottom[id]);
+    _top.push_back(from._top[id]);
+    _offset.push_back(_interior.size());
+    size_t begin = from._offset[id], end = begin + size_t(from._top[id] - from._bottom[id]) * from._row_words;
+    _interior.insert(_interior.end(), from._interior.begin() + begin, from._interior.begin() + end);
+    _covered.insert(_covered.end(), from._covered.begin() + begin, from._covered.begin() + end);
+}
+
+////////////////////////////////////
+//        Conflict Matrix         //
+////////////////////////////////////
+
+/*
+ *  How many bits of `bits` are set between IDs `from` (inclusive) and `to` (exclusive). With a bitset of
+ *  surviving placements this is the size of one triangle's domain.
+ */
+
+int count_in_range(const uint64_t* bits, int from, int to) {
+    if (from >= to) return 0;
+
+    int first_word = from / 64, last_word = (to - 1) / 64;
+    uint64_t first_mask = ~uint64_t(0) << (from % 64);
+    uint64_t last_mask = ~uint64_t(0) >> (63 - (to - 1) % 64);
+
+    if (first_word == last_word) return __builtin_popcountll(bits[first_word] & first_mask & last_mask);
+
+    int count = __builtin_popcountll(bits[first_word] & first_mask) + __builtin_popcountll(bits[last_word] & last_mask);
+    for (int w = first_word + 1; w < last_word; w++) {
+        count += __builtin_popcountll(bits[w]);
+    }
+    return count;
+}
+
+namespace {
+
+// Clear the bits of `bits` between IDs `from` (inclusive) and `to` (exclusive).
+void clear_range(uint64_t* bits, int from, int to) {
+    if (from >= to) return;
+
+    int first_word = from / 64, last_word = (to - 1) / 64;
+    uint64_t first_mask = ~uint64_t(0) << (from % 64);
+    uint64_t last_mask = ~uint64_t(0) >> (63 - (to - 1) % 64);
+
+    if (first_word == last_word) {
+        bits[first_word] &= ~(first_mask & last_mask);
+        return;
+    }
+    bits[first_word] &= ~first_mask;
+    bits[last_word] &= ~last_mask;
+    std::fill(bits + first_word + 1, bits + last_word, 0);
+}
+
+}
+
+/*
+ *  True if some placement between IDs `from` (inclusive) and `to` (exclusive) is set in `alive` but not in `row`.
+ *  With `row` a conflict row, that's whether the range still has a candidate that fits alongside the placement.
+ */
+
+bool any_outside_row(const uint64_t* alive, const uint64_t* row, int from, int to) {
+    if (from >= to) return false;
+
+    int first_word = from / 64, last_word = (to - 1) / 64;
+    uint64_t first_mask = ~uint64_t(0) << (from % 64);
+    uint64_t last_mask = ~uint64_t(0) >> (63 - (to - 1) % 64);
+
+    if (first_word == last_word) return (alive[first_word] & ~row[first_word] & first_mask & last_mask) != 0;
+
+    if ((alive[first_word] & ~row[first_word] & first_mask) || (alive[last_word] & ~row[last_word] & last_mask)) {
+        return true;
+    }
+    for (int w = first_word + 1; w < last_word; w++) {
+        if (alive[w] & ~row[w]) return true;
+    }
+    return false;
+}
+
+conflict_matrix build_conflict_matrix(const vector<Triangle>& board) {
+    conflict_matrix conflicts;
+    build_conflict_matrix(board, conflicts);
+    return conflicts;
+}
+
+// As above, into `conflicts`, which keeps its memory for the new matrix.
+void build_conflict_matrix(const vector<Triangle>& board, conflict_matrix& conflicts) {
+    conflicts._first.assign(1, 0);
+    for (const auto& triangle : board) {
+        conflicts._first.push_back(conflicts._first.back() + triangle.all_triangles.size());
+    }
+    conflicts._total = conflicts._first.back();
+    conflicts._words = (conflicts._total + 63) / 64;
+    conflicts._bits.assign(size_t(conflicts._total) * conflicts._words, 0);
+    rasterise_placements(board, conflicts._bitboards);
+    const placement_bitboards& boards = conflicts._bitboards;
+
+    // Each triangle's candidates all lie inside the union of their bounding boxes; two triangles whose unions are
+    // apart can't have a conflicting pair between them.
+    vector<int> left(board.size()), right(board.size()), bottom(board.size()), top(board.size());
+    for (int i{}; i < board.size(); i++) {
+        int first = conflicts._first[i], end = conflicts._first[i + 1];
+        left[i] = first == end ? 0 : *std::min_element(&boards._left[first], &boards._left[end]);
+        right[i] = first == end ? 0 : *std::max_element(&boards._right[first], &boards._right[end]);
+        bottom[i] = first == end ? 0 : *std::min_element(&boards._bottom[first], &boards._bottom[end]);
+        top[i] = first == end ? 0 : *std::max_element(&boards._top[first], &boards._top[end]);
+    }
+
+    vector<int> hits;
+    for (int i{}; i < board.size(); i++) {
+        const placement_list& mine = board[i].all_triangles;
+        for (int k = i + 1; k < board.size(); k++) {
+            if (right[i] <= left[k] || right[k] <= left[i] || top[i] <= bottom[k] || top[k] <= bottom[i]) continue;
+
+            const placement_list& theirs = board[k].all_triangles;
+            for (int j{}; j < mine.size(); j++) {
+                int id = conflicts._first[i] + j;
+                placements_conflicting(mine, j, theirs, hits);
+                for (int l : hits) {
+                    int other = conflicts._first[k] + l;
+                    conflicts._bits[size_t(id) * conflicts._words + other / 64] |= uint64_t(1) << (other % 64);
+                    conflicts._bits[size_t(other) * conflicts._words + id / 64] |= uint64_t(1) << (id % 64);
+                }
+            }
+        }
+    }
+}
+
+namespace {
+
+/*
+ *  Rebuild the board, the conflict matrix and its bitboards with just the placements in `chosen`, which lists old
+ *  IDs with each triangle's together and the triangles in board order. They are numbered afresh in the order
+ *  they're listed, so a triangle's candidates can be dropped or reordered, but never gain one.
+ *
+ *  The new matrix is built in `scratch` and swapped with `conflicts`, so the old one's buffers are left in `scratch`
+ *  to be built over next time, and a caller that keeps `scratch` around stops allocating once both are big enough.
+ *  The bitboards are copied across rather than rasterised again.
+ */
+
+void renumber_placements(vector<Triangle>& board, conflict_matrix& conflicts, const vector<int>& chosen,
+                         conflict_matrix& scratch) {
+    const int triangles = board.size();
+    vector<int> renumbered(conflicts._total, -1);
+    conflict_matrix& result = scratch;
+    result._first.assign(triangles + 1, 0);
+    for (int n{}; n < chosen.size(); n++) {
+        renumbered[chosen[n]] = n;
+        result._first[conflicts.triangle_of(chosen[n]) + 1]++;
+    }
+    for (int i{}; i < triangles; i++) {
+        result._first[i + 1] += result._first[i];
+
+        vector<int> indices;
+        for (int n = result._first[i]; n < result._first[i + 1]; n++) indices.push_back(chosen[n] - conflicts._first[i]);
+        board[i].all_triangles.select(indices);
+    }
+    result._total = chosen.size();
+    result._words = (result._total + 63) / 64;
+    result._bits.assign(size_t(result._total) * result._words, 0);
+
+    for (int n{}; n < chosen.size(); n++) {
+        const uint64_t* bits = conflicts.row(chosen[n]);
+        uint64_t* row = &result._bits[size_t(n) * result._words];
+        for (int w{}; w < conflicts._words; w++) {
+            for (uint64_t word = bits[w]; word; word &= word - 1) {
+                int other = renumbered[w * 64 + __builtin_ctzll(word)];
+                if (other >= 0) row[other / 64] |= uint64_t(1) << (other % 64);
+            }
+        }
+    }
+    result._bitboards.clear(conflicts._bitboards._height, conflicts._bitboards._row_words);
+    for (int id : chosen) result._bitboards.append(conflicts._bitboards, id);
+
+    std::swap(conflicts, result);
+}
+
+}
+
+/*
+ *  Arc consistency (AC-3) over the conflict matrix. A candidate of board[i] that conflicts with every remaining
+ *  candidate of some other board[k] can't be in any solution, so it goes. That shrinks i's domain, which can leave
+ *  candidates of i's neighbours (the triangles with a candidate that conflicts with one of i's) without support
+ *  in turn, so i goes on the worklist to have its neighbours checked against it again. Every triangle starts out
+ *  on the worklist, and it runs until the worklist is empty.
+ *
+ *  Nothing is erased along the way: the survivors are an alive bitset, and the board, the conflict matrix and its
+ *  bitboards are compacted down to them once at the end. Returns how many candidates were removed. If a domain
+ *  empties the puzzle has no solution, propagation stops there, and the search finds that out straight away.
+ */
+
+int propagate_arc_consistency(vector<Triangle>& board, conflict_matrix& conflicts) {
+    conflict_matrix scratch;
+    return propagate_arc_consistency(board, conflicts, scratch);
+}
+
+int propagate_arc_consistency(vector<Triangle>& board, conflict_matrix& conflicts, conflict_matrix& scratch) {
+    const int triangles = board.size();
+    vector<uint64_t> alive(conflicts._words, ~uint64_t(0));
+    if (conflicts._total % 64) alive.back() >>= 64 - conflicts._total % 64;
+
+    vector<char> adjacent(size_t(triangles) * triangles, false);
+    for (int id{}; id < conflicts._total; id++) {
+        int i = conflicts.triangle_of(id);
+        const uint64_t* bits = conflicts.row(id);
+        for (int w{}; w < conflicts._words; w++) {
+            for (uint64_t word = bits[w]; word; word &= word - 1) {
+                adjacent[size_t(i) * triangles + conflicts.triangle_of(w * 64 + __builtin_ctzll(word))] = true;
+            }
+        }
+    }
+
+    vector<int> worklist(triangles);
+    vector<char> waiting(triangles, true);
+    for (int k{}; k < triangles; k++) worklist[k] = triangles - 1 - k;
+
+    int removed = 0;
+    bool emptied = false;
+    while (!worklist.empty() && !emptied) {
+        int k = worklist.back();
+        worklist.pop_back();
+        waiting[k] = false;
+
+        for (int i{}; i < triangles && !emptied; i++) {
+            if (!adjacent[size_t(i) * triangles + k]) continue;
+
+            bool revised = false;
+            for (int id = conflicts._first[i]; id < conflicts._first[i + 1]; id++) {
+                if (!(alive[id / 64] >> (id % 64) & 1)) continue;
+                if (any_outside_row(alive.data(), conflicts.row(id), conflicts._first[k], conflicts._first[k + 1])) continue;
+
+                alive[id / 64] &= ~(uint64_t(1) << (id % 64));
+                removed++;
+                revised = true;
+            }
+            if (!revised) continue;
+
+            emptied = count_in_range(alive.data(), conflicts._first[i], conflicts._first[i + 1]) == 0;
+            if (!waiting[i]) {
+                waiting[i] = true;
+                worklist.push_back(i);
+            }
+        }
+    }
+    if (removed == 0) return 0;
+
+    vector<int> survivors;
+    for (int id{}; id < conflicts._total; id++) {
+        if (alive[id / 64] >> (id % 64) & 1) survivors.push_back(id);
+    }
+    renumber_placements(board, conflicts, survivors, scratch);
+    return removed;
+}
+
+/*
+ *  Least-constraining-value ordering: sort each triangle's candidates so the ones with the fewest conflicts come
+ *  first, keeping their current order on a tie, and renumber them to match. Both search modes try a triangle's
+ *  candidates in ID order, so a solution, if there is one, tends to turn up sooner. forward_checking goes on to
+ *  refine the order at every node against what's still alive (see open_level).
+ */
+
+void order_least_constraining(vector<Triangle>& board, conflict_matrix& conflicts) {
+    conflict_matrix scratch;
+    order_least_constraining(board, conflicts, scratch);
+}
+
+void order_least_constraining(vector<Triangle>& board, conflict_matrix& conflicts, conflict_matrix& scratch) {
+    vector<int> conflicting(conflicts._total);
+    vector<int> chosen(conflicts._total);
+    for (int id{}; id < conflicts._total; id++) {
+        chosen[id] = id;
+        conflicting[id] = count_in_range(conflicts.row(id), 0, conflicts._total);
+    }
+    for (int i{}; i < board.size(); i++) {
+        std::stable_sort(chosen.begin() + conflicts._first[i], chosen.begin() + conflicts._first[i + 1],
+                         [&](int a, int b) { return conflicting[a] < conflicting[b]; });
+    }
+    renumber_placements(board, conflicts, chosen, scratch);
+}
+
+namespace {
+
+// Expand cubes from `level`, where levels[level] holds the domains with `level` triangles placed.
+void expand_cubes_from(const conflict_matrix& conflicts, vector<uint64_t>& levels, vector<char>& placed, int level,
+                       int depth, const cube_sink& sink, uint64_t& cubes) {
+    const uint64_t* domains = &levels[size_t(level) * conflicts._words];
+    if (level == depth) {
+        sink(domains);
+        cubes++;
+        return;
+    }
+
+    int index = -1, smallest = 0;
+    for (int k{}; k < placed.size(); k++) {
+        if (placed[k]) continue;
+        int size = count_in_range(domains, conflicts._first[k], conflicts._first[k + 1]);
+        if (index == -1 || size < smallest) {
+            index = k;
+            smallest = size;
+        }
+    }
+
+    placed[index] = true;
+    uint64_t* next = &levels[size_t(level + 1) * conflicts._words];
+    for (int id = conflicts._first[index]; id < conflicts._first[index + 1]; id++) {
+        if (!(domains[id / 64] >> (id % 64) & 1)) continue;
+
+        const uint64_t* bits = conflicts.row(id);
+        for (int w{}; w < conflicts._words; w++) {
+            next[w] = domains[w] & ~bits[w];
+        }
+        clear_range(next, conflicts._first[index], conflicts._first[index + 1]);
+        next[id / 64] |= uint64_t(1) << (id % 64);
+
+        bool emptied = false;
+        for (int k{}; k < placed.size() && !emptied; k++) {
+            emptied = !placed[k] && count_in_range(next, conflicts._first[k], conflicts._first[k + 1]) == 0;
+        }
+        if (!emptied) expand_cubes_from(conflicts, levels, placed, level + 1, depth, sink, cubes);
+    }
+    placed[index] = false;
+}
+
+}
+
+uint64_t expand_cubes(const conflict_matrix& conflicts, int depth, const cube_sink& sink) {
+    const int triangles = conflicts._first.size() - 1;
+    depth = std::max(0, std::min(depth, triangles));
+
+    vector<uint64_t> levels(size_t(depth + 1) * conflicts._words);
+    std::fill(levels.begin(), levels.begin() + conflicts._words, ~uint64_t(0));
+    if (conflicts._total % 64) levels[conflicts._words - 1] >>= 64 - conflicts._total % 64;
+    for (int k{}; k < triangles; k++) {
+        if (conflicts._first[k] == conflicts._first[k + 1]) return 0;
+    }
+
+    vector<char> placed(triangles);
+    uint64_t cubes = 0;
+    expand_cubes_from(conflicts, levels, placed, 0, depth, sink, cubes);
+    return cubes;
+}
+
+////////////////////////////////////
+//   Preprocessing and Solution   //
+////////////////////////////////////
+
+/*
+ *  Preprocess all the triangles. A placement that covers any part of another clue's square can never be in a
+ *  solution, since that clue's own triangle has to cover its square, so throw those away up front.
+ *
+ *  THIS CUTS RUNTIME IN HALF.
+ */
+
+void pre_process_valid_triangles(vector<Triangle>& board) {
+    for (int i{}; i < board.size(); i++) {
+        placement_list& candidates = board[i].all_triangles;
+        vector<char> keep(candidates.size(), true);
+        for (int j{}; j < candidates.size(); j++) {
+            for (int k{}; k < board.size() && keep[j]; k++) {
+                if (k != i && covers_square(candidates, j, board[k].getXC(), board[k].getYC())) keep[j] = false;
+            }
+        }
+        candidates.compact(keep);
+    }
+}
+
+void print_solution(std::ostream& out, const vector<Point>& board) {
+    for (int j{}; j < board.size(); j += 3) {
+        out << "Printing Triangle Coordinates: ";
+        out << "(" << board[j].x << "," << board[j].y <<  ") | (";
+        out << board[j+1].x << "," << board[j+1].y << ") | (" ;
+        out << board[j+2].x << "," << board[j+2].y << ") ";
+        out << "\n";
+    }
+    out << "\n";
+}
+
+/*
+ *  Print the placements listed in placed_ids to `out`. Every ID is turned back into its three vertices,
+ *  in the same (q, p, r) order the search has always printed them in. placement_vertices does the turning back,
+ *  three vertices per triangle in board order, as print_solution takes them.
+ */
+
+void print_placements(std::ostream& out, const vector<Triangle>& board, const conflict_matrix& conflicts,
+                      const vector<int>& placed_ids) {
+    vector<Point> solution_vector;
+    placement_vertices(board, conflicts, placed_ids, solution_vector);
+    print_solution(out, solution_vector);
+}
+
+void placement_vertices(const vector<Triangle>& board, const conflict_matrix& conflicts, const vector<int>& placed_ids,
+                        vector<Point>& vertices) {
+    // The search may place the triangles in any order; lay them out in board order.
+    vertices.assign(3 * board.size(), Point(0, 0));
+    for (int id : placed_ids) {
+        int i = conflicts.triangle_of(id), local = id - conflicts._first[i];
+        const placement_list& candidates = board[i].all_triangles;
+        vertices[3 * i] = candidates.b(local);
+        vertices[3 * i + 1] = candidates.a(local);
+        vertices[3 * i + 2] = candidates.c(local);
+    }
+}
+
+void solution_writer::write(const vector<int>& placed_ids) {
+    print_placements(_buffer, _board, _conflicts, placed_ids);
+    if (_buffer.tellp() >= 1 << 16) flush();
+}
+
+void solution_writer::flush() {
+    _out << _buffer.str();
+    _out.flush();
+    _buffer.str("");
+}
+
+////////////////////////////////////
+//        Parallel Search         //
+////////////////////////////////////
+
+/*
+ *  Every worker owns a deque of tasks. A worker pushes and pops at the back of its own deque, so on its
+ *  own it walks the tree depth first, exactly like the single threaded search. An idle worker steals from
+ *  the front of somebody else's deque, which holds the oldest (shallowest, and so biggest) subtrees.
+ *
+ *  _pending counts tasks that were pushed but haven't finished yet. A task pushes its children before it
+ *  is marked done, so once _pending hits zero there is nothing left anywhere and the workers can stop.
+ *
+ *  A worker that finds nothing to take sleeps in wait() rather than spinning. _signals counts everything that could
+ *  give it something to do: a push, a task finishing (which may leave the pool idle, or the search cancelled), and
+ *  wake(). A worker reads signals() before it looks for a task and hands that to wait(), which returns as soon as
+ *  the count has moved on, so nothing that happens in between is missed.
+ */
+
+namespace {
+
+class work_stealing_pool {
+    private:
+
+        struct worker_queue {
+            std::mutex _mutex;
+            std::deque<search_task> _tasks;
+        };
+
+        vector<worker_queue> _queues;
+        std::atomic<int> _pending;
+
+        std::mutex _sleep_mutex;
+        std::condition_variable _woken;
+        uint64_t _signals;
+
+        void signal(bool everyone);
+
+    public:
+
+        explicit work_stealing_pool(int workers) : _queues(workers), _pending(0), _signals(0) {};
+
+        void push(int worker, search_task task);
+        bool pop(int worker, search_task& task);
+
+        uint64_t signals();
+        void wait(uint64_t seen);
+        void wake() { signal(true); };
+
+        void snapshot(vector<search_task>& tasks);
+        void task_done() {
+            _pending.fetch_sub(1);
+            signal(true);
+        };
+        bool idle() const { return _pending.load() == 0; };
+        int pending() const { return _pending.load(); };
+};
+
+void work_stealing_pool::push(int worker, search_task task) {
+    _pending.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(_queues[worker]._mutex);
+        _queues[worker]._tasks.push_back(std::move(task));
+    }
+    signal(false);
+}
+
+void work_stealing_pool::signal(bool everyone) {
+    {
+        std::lock_guard<std::mutex> lock(_sleep_mutex);
+        _signals++;
+    }
+    if (everyone) {
+        _woken.notify_all();
+    } else {
+        _woken.notify_one();
+    }
+}
+
+uint64_t work_stealing_pool::signals() {
+    std::lock_guard<std::mutex> lock(_sleep_mutex);
+    return _signals;
+}
+
+void work_stealing_pool::wait(uint64_t seen) {
+    std::unique_lock<std::mutex> lock(_sleep_mutex);
+    _woken.wait(lock, [&]() { return _signals != seen; });
+}
+
+// Append a copy of every task waiting in the pool to `tasks`.
+void work_stealing_pool::snapshot(vector<search_task>& tasks) {
+    for (worker_queue& queue : _queues) {
+        std::lock_guard<std::mutex> lock(queue._mutex);
+        tasks.insert(tasks.end(), queue._tasks.begin(), queue._tasks.end());
+    }
+}
+
+bool work_stealing_pool::pop(int worker, search_task& task) {
+    {
+        std::lock_guard<std::mutex> lock(_queues[worker]._mutex);
+        if (!_queues[worker]._tasks.empty()) {
+            task = std::move(_queues[worker]._tasks.back());
+            _queues[worker]._tasks.pop_back();
+            return true;
+        }
+    }
+
+    // Nothing of our own left: try everybody else, starting with our neighbour.
+    for (int i = 1; i < _queues.size(); i++) {
+        worker_queue& victim = _queues[(worker + i) % _queues.size()];
+        std::lock_guard<std::mutex> lock(victim._mutex);
+        if (!victim._tasks.empty()) {
+            task = std::move(victim._tasks.front());
+            victim._tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ *  Everything the workers share. Every time a worker completes the board it counts a solution, and the
+ *  first one's placements go in solution_ids. Once there are `limit` of them it raises cancelled; every other
+ *  worker sees the flag at its next node and unwinds. The caller can stop the search the same way by raising *stop.
+ *
+ *  When progress is on, the workers add their node counts to sampled_nodes in batches and keep deepest up to
+ *  date, for the progress reporter to read. Their search_stats are merged into stats as they finish.
+ *
+ *  With a seed, conflicting[id] is how many placements id conflicts with, to order static_order's candidates by.
+ *  With restarts there is only the one worker, and the whole search is a single task that it keeps starting over.
+ *
+ *  To take a checkpoint, checkpoint_due is raised. Each of the `active` workers adds what it has left to frontier
+ *  and waits, counted in `paused`, until checkpoint_round moves on (see take_checkpoint).
+ */
+
+struct search_shared {
+    const vector<Triangle>& board;
+    const conflict_matrix& conflicts;
+    search_mode mode;
+    uint64_t restart_nodes;
+    int workers;
+    int split_depth;
+
+    work_stealing_pool pool;
+    std::atomic<bool> cancelled;
+    const std::atomic<bool>* stop;
+
+    uint64_t limit;
+    const solution_sink& sink;
+    bool backjumping;
+    int nogood_capacity;
+    bool value_order;
+    uint64_t seed;
+    vector<int> conflicting;
+    std::atomic<uint64_t> solutions;
+    std::mutex solution_mutex;
+    vector<int> solution_ids;
+
+    bool progress;
+    std::atomic<uint64_t> sampled_nodes;
+    std::atomic<int> deepest;
+
+    std::mutex stats_mutex;
+    search_stats* stats;
+
+    std::atomic<bool> checkpoint_due;
+    std::mutex checkpoint_mutex;
+    std::condition_variable checkpoint_changed;
+    int active;
+    int paused;
+    uint64_t checkpoint_round;
+    vector<search_task> frontier;
+
+    search_shared(const vector<Triangle>& b, const conflict_matrix& c, const search_options& options, search_stats* s)
+        : board(b), conflicts(c), mode(options.mode),
+          restart_nodes(options.limit == 1 ? options.restart_nodes : 0),
+          workers(restart_nodes ? 1 : options.threads), split_depth(restart_nodes ? 0 : options.split_depth),
+          pool(workers), cancelled(false), stop(options.stop), limit(options.limit), sink(options.sink),
+          backjumping(options.backjumping), nogood_capacity(options.backjumping ? options.nogood_capacity : 0),
+          value_order(options.value_order), seed(options.seed), solutions(0), progress(options.progress_seconds > 0),
+          sampled_nodes(0), deepest(0), stats(s), checkpoint_due(false), active(workers), paused(0),
+          checkpoint_round(0) {
+        if (seed) {
+            conflicting.resize(conflicts._total);
+            for (int id{}; id < conflicts._total; id++) {
+                conflicting[id] = count_in_range(conflicts.row(id), 0, conflicts._total);
+            }
+        }
+    };
+
+    bool stopped() const {
+        return cancelled.load(std::memory_order_relaxed) || (stop && stop->load(std::memory_order_relaxed));
+    }
+
+    void record_solution(const vector<int>& ids);
+};
+
+// Only the first solution and the sink need the lock, so counting every solution of a puzzle stays cheap.
+void search_shared::record_solution(const vector<int>& ids) {
+    uint64_t found = solutions.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (limit && found > limit) return;
+
+    if (found == 1 || sink) {
+        std::lock_guard<std::mutex> lock(solution_mutex);
+        if (found == 1) solution_ids = ids;
+        if (sink) sink(ids);
+    }
+    if (limit && found == limit) cancelled.store(true);
+}
+
+/*
+ *  A worker's learned nogoods: sets of up to nogood_size placement IDs that can't all be in a solution together.
+ *  It holds at most _capacity of them, one per slot, and once it is full each new one takes the oldest one's slot.
+ *  _members has nogood_size IDs per slot, padded with -1. Entry slot * nogood_size + m of _members is also a link
+ *  in a list of the nogoods placement _members[entry] is in, oldest first: _head[id] and _tail[id] are the ends of
+ *  id's list, and _after and _before link each entry to the next and the one before, -1 at either end. Everything
+ *  is sized in reset(), so learning a nogood and dropping the oldest is a few links, with nothing allocated.
+ */
+
+struct nogood_cache {
+    static const int nogood_size = 8;
+
+    int _capacity;
+    int _next;
+    vector<int> _members;
+    vector<int> _head, _tail;
+    vector<int> _after, _before;
+
+    // Empty it, with room for `capacity` nogoods over `total` placements, keeping whatever memory it had.
+    void reset(int capacity, int total) {
+        _capacity = capacity;
+        _next = 0;
+        _members.assign(size_t(capacity) * nogood_size, -1);
+        _head.assign(capacity ? total : 0, -1);
+        _tail.assign(capacity ? total : 0, -1);
+        _after.assign(size_t(capacity) * nogood_size, -1);
+        _before.assign(size_t(capacity) * nogood_size, -1);
+    }
+
+    const int* members(int slot) const { return &_members[size_t(slot) * nogood_size]; }
+    void add(const int* ids, int count);
+};
+
+void nogood_cache::add(const int* ids, int count) {
+    int slot = _next;
+    _next = (_next + 1) % _capacity;
+
+    int* members = &_members[size_t(slot) * nogood_size];
+    for (int m{}; m < nogood_size && members[m] >= 0; m++) {
+        int entry = slot * nogood_size + m, id = members[m];
+        (_before[entry] >= 0 ? _after[_before[entry]] : _head[id]) = _after[entry];
+        (_after[entry] >= 0 ? _before[_after[entry]] : _tail[id]) = _before[entry];
+    }
+    for (int m{}; m < nogood_size; m++) {
+        members[m] = m < count ? ids[m] : -1;
+        if (m >= count) continue;
+
+        int entry = slot * nogood_size + m, id = ids[m];
+        _before[entry] = _tail[id];
+        _after[entry] = -1;
+        (_tail[id] >= 0 ? _after[_tail[id]] : _head[id]) = entry;
+        _tail[id] = entry;
+    }
+}
+
+/*
+ *  One worker's search state. reset() sizes it for a full board when the worker starts, and walking the tree
+ *  only ever moves _depth up and down inside it, so the search itself never touches the heap. The stacks live in a
+ *  search_workspace, so a later search can have them again with the memory they already have.
+ *
+ *  _ids[d] is the placement chosen at depth d and _triangle[d] the board index being placed at depth d.
+ *  order(d) holds the _count[d] candidates to try there, in the order to try them, and _cursor[d] is the position
+ *  in it of the next one. _scores is open_level's scratch space for ordering them. _assigned[k] says whether
+ *  board[k] is on the board.
+ *
+ *  _stats is this worker's own search_stats, or null when nobody asked for them. _unpublished and _deepest are
+ *  what it hasn't yet told the progress reporter.
+ *
+ *  _arena holds one bitset of _words words per depth:
+ *  - In static_order mode only level 0 is used, as the set of placed IDs. A placement is undone by
+ *    clearing its bit again. Alongside it, _interior and _covered are the board's squares as covered by every
+ *    placed triangle (see placement_bitboards), and _saved[d] keeps the rows that placing at depth d overwrote.
+ *  - In forward_checking mode level d is the set of placements still alive at depth d, and placing a
+ *    candidate writes level d + 1. Backing up is just going back to level d, so there is nothing to undo.
+ *
+ *  For backjumping, culprits(d) is a bitset of depths (_depth_words words) whose placements helped rule out
+ *  the candidates tried at depth d so far, and _below_solution[d] says a solution was found somewhere under the
+ *  current placement at depth d. _placed_at[id] is the depth placement id was last placed at, which is only
+ *  current while _ids there still says id. _nogoods is this worker's nogood_cache; it outlives the tasks.
+ *
+ *  _random breaks ties when there is a seed. With restarts, _spent counts the nodes of the current run against
+ *  its _budget, and _runs how many runs there have been.
+ */
+
+struct search_stack {
+    int _words;
+    int _depth;
+    vector<int> _ids;
+    vector<int> _triangle;
+    vector<int> _cursor;
+    int _domain;
+    vector<int> _order;
+    vector<int> _count;
+    vector<std::pair<uint64_t, int>> _scores;
+    vector<char> _assigned;
+    vector<uint64_t> _arena;
+
+    int _board_words;
+    vector<uint64_t> _interior;
+    vector<uint64_t> _covered;
+    vector<uint64_t> _saved;
+
+    int _depth_words;
+    vector<uint64_t> _culprits;
+    vector<char> _below_solution;
+    vector<int> _placed_at;
+    nogood_cache _nogoods;
+
+    std::mt19937_64 _random;
+    uint64_t _budget;
+    uint64_t _spent;
+    uint64_t _runs;
+
+    search_stats* _stats;
+    uint64_t _unpublished;
+    int _deepest;
+
+    void reset(int triangles, int words, int domain, int board_words, int total, int nogood_capacity,
+               search_stats* stats) {
+        _words = words;
+        _depth = 0;
+        _ids.assign(triangles, 0);
+        _triangle.assign(triangles + 1, 0);
+        _cursor.assign(triangles + 1, 0);
+        _domain = domain;
+        _order.assign(size_t(triangles + 1) * domain, 0);
+        _count.assign(triangles + 1, 0);
+        _scores.assign(domain, {});
+        _assigned.assign(triangles, false);
+        _arena.assign(size_t(triangles + 1) * words, 0);
+        _board_words = board_words;
+        _interior.assign(board_words, 0);
+        _covered.assign(board_words, 0);
+        _saved.assign(size_t(triangles) * 2 * board_words, 0);
+        _depth_words = (triangles + 63) / 64;
+        _culprits.assign(size_t(triangles + 1) * _depth_words, 0);
+        _below_solution.assign(triangles + 1, false);
+        _placed_at.assign(total, -1);
+        _nogoods.reset(nogood_capacity, total);
+        _random.seed();
+        _budget = _spent = _runs = 0;
+        _stats = stats;
+        _unpublished = 0;
+        _deepest = 0;
+    }
+
+    uint64_t* level(int depth) { return &_arena[size_t(depth) * _words]; }
+    int* order(int depth) { return &_order[size_t(depth) * _domain]; }
+    uint64_t* saved(int depth) { return &_saved[size_t(depth) * 2 * _board_words]; }
+    uint64_t* culprits(int depth) { return &_culprits[size_t(depth) * _depth_words]; }
+
+    // Blame depth `culprit` for ruling out a candidate at `depth`.
+    void blame(int depth, int culprit) { culprits(depth)[culprit / 64] |= uint64_t(1) << (culprit % 64); }
+
+    // Whether placement `id` is on the board above `depth`.
+    bool placed(int id, int depth) const {
+        int at = _placed_at[id];
+        return at >= 0 && at < depth && _ids[at] == id;
+    }
+};
+
+}
+
+// One search_stack per worker, kept from one parallel_solution to the next by whoever owns it.
+struct search_workspace {
+    vector<search_stack> _stacks;
+};
+
+namespace {
+
+/*
+ *  Work out which triangle gets placed at stack._depth and line up its candidates to try. static_order takes the
+ *  board in order and tries every candidate in ID order; forward_checking takes the unplaced triangle with the
+ *  smallest domain, the earliest one on the board on a tie, and tries only the live ones. With value_order it
+ *  tries them by how many live candidates of the other unplaced triangles each conflicts with, fewest first.
+ *
+ *  With a seed, ties go to a random one instead: a random triangle among the smallest domains, and a random order
+ *  among equally constraining candidates. static_order then orders them by conflicting, as order_least_constraining
+ *  did, or with no value_order at all, shuffles them.
+ *
+ *  A task with choices has its first depth take those, in that order, instead.
+ *
+ *  With backjumping the depth's culprits start out empty, except in forward_checking, where the placements that
+ *  took candidates out of the triangle's domain are already to blame for those.
+ */
+
+// Blame every placement above `depth` with a conflict in board[k]'s candidates, for taking them out of its domain.
+void blame_pruners(const search_shared& shared, search_stack& stack, int k, int depth) {
+    const conflict_matrix& conflicts = shared.conflicts;
+    for (int e{}; e < depth; e++) {
+        if (count_in_range(conflicts.row(stack._ids[e]), conflicts._first[k], conflicts._first[k + 1])) {
+            stack.blame(depth, e);
+        }
+    }
+}
+
+void open_level(const search_shared& shared, search_stack& stack, const vector<int>& choices) {
+    const conflict_matrix& conflicts = shared.conflicts;
+    int depth = stack._depth;
+    int index = depth;
+
+    if (!choices.empty()) {
+        index = conflicts.triangle_of(choices[0]);
+    } else if (shared.mode == search_mode::forward_checking) {
+        const uint64_t* alive = stack.level(depth);
+        int smallest = 0, ties = 0;
+        index = -1;
+        for (int k{}; k < shared.board.size(); k++) {
+            if (stack._assigned[k]) continue;
+            int size = count_in_range(alive, conflicts._first[k], conflicts._first[k + 1]);
+            if (index == -1 || size < smallest) {
+                index = k;
+                smallest = size;
+                ties = 1;
+            } else if (size == smallest && shared.seed && stack._random() % ++ties == 0) {
+                index = k;
+            }
+        }
+    }
+
+    stack._triangle[depth] = index;
+    stack._assigned[index] = true;
+
+    int* order = stack.order(depth);
+    int count = 0;
+    const uint64_t* alive = shared.mode == search_mode::forward_checking ? stack.level(depth) : nullptr;
+    for (int id = conflicts._first[index]; id < conflicts._first[index + 1] && choices.empty(); id++) {
+        if (!alive || alive[id / 64] >> (id % 64) & 1) order[count++] = id;
+    }
+    for (int id : choices) order[count++] = id;
+    if (count > 1 && choices.empty() && ((alive && shared.value_order) || shared.seed)) {
+        for (int n{}; n < count; n++) {
+            uint64_t conflicting = 0;
+            if (shared.value_order && alive) {
+                const uint64_t* bits = conflicts.row(order[n]);
+                for (int w{}; w < stack._words; w++) conflicting += __builtin_popcountll(bits[w] & alive[w]);
+            } else if (shared.value_order) {
+                conflicting = shared.conflicting[order[n]];
+            }
+            uint64_t tiebreak = shared.seed ? stack._random() >> 32 : order[n];
+            stack._scores[n] = {conflicting << 32 | tiebreak, order[n]};
+        }
+        std::sort(stack._scores.begin(), stack._scores.begin() + count);
+        for (int n{}; n < count; n++) order[n] = stack._scores[n].second;
+    }
+    stack._count[depth] = count;
+    stack._cursor[depth] = 0;
+
+    if (shared.backjumping) {
+        std::fill(stack.culprits(depth), stack.culprits(depth) + stack._depth_words, 0);
+        stack._below_solution[depth] = false;
+        if (shared.mode == search_mode::forward_checking) blame_pruners(shared, stack, index, depth);
+    }
+}
+
+/*
+ *  Try to put placement `id` on the board at stack._depth. Returns false, with nothing changed, if it doesn't fit.
+ *
+ *  static_order: the occupied squares settle most candidates with a few ANDs over the rows the candidate spans.
+ *  Only one that shares nothing but partly covered squares with the board needs its conflict row checked against
+ *  the placed set. If it fits it is added to the set and its squares to the occupied ones.
+ *
+ *  forward_checking: it fits when it is still alive. Its conflict row is then cleared out of the alive set to give
+ *  the next level, which prunes every other domain in one pass. If that empties the domain of any triangle still
+ *  to be placed, the placement is a dead end and is rejected straight away rather than being found out however
+ *  many levels further down.
+ *
+ *  Either way, a candidate that completes a learned nogood with what's already placed doesn't fit either. With
+ *  backjumping every rejection blames the depths responsible: the placement it conflicts with (static_order), or
+ *  every placement that pruned the domain it emptied (forward_checking), or the rest of the nogood.
+ */
+
+// True, blaming the rest of it, if placing `id` at stack._depth would complete one of the worker's nogoods.
+bool completes_nogood(search_stack& stack, int id) {
+    int depth = stack._depth;
+    const nogood_cache& nogoods = stack._nogoods;
+    for (int entry = nogoods._head[id]; entry >= 0; entry = nogoods._after[entry]) {
+        const int* members = nogoods.members(entry / nogood_cache::nogood_size);
+        bool complete = true;
+        for (int m{}; m < nogood_cache::nogood_size && members[m] >= 0 && complete; m++) {
+            complete = members[m] == id || stack.placed(members[m], depth);
+        }
+        if (!complete) continue;
+
+        for (int m{}; m < nogood_cache::nogood_size && members[m] >= 0; m++) {
+            if (members[m] != id) stack.blame(depth, stack._placed_at[members[m]]);
+        }
+        if (stack._stats) stack._stats->pruned[prune_nogood]++;
+        return true;
+    }
+    return false;
+}
+
+// Count candidate `id` as pruned because it conflicts with placement `by`.
+void count_prune(const search_shared& shared, search_stats& stats, int id, int by) {
+    const conflict_matrix& conflicts = shared.conflicts;
+    int mine = conflicts.triangle_of(id), theirs = conflicts.triangle_of(by);
+    stats.pruned[conflict_reason(shared.board[mine].all_triangles, id - conflicts._first[mine],
+                                 shared.board[theirs].all_triangles, by - conflicts._first[theirs])]++;
+}
+
+// Add placement `id`'s squares to the occupied ones, saving the rows it changes in depth's slot.
+void occupy(const placement_bitboards& boards, search_stack& stack, int id, int depth) {
+    size_t first = size_t(boards._bottom[id]) * boards._row_words;
+    int words = (boards._top[id] - boards._bottom[id]) * boards._row_words;
+    uint64_t* saved = stack.saved(depth);
+    std::copy(&stack._interior[first], &stack._interior[first] + words, saved);
+    std::copy(&stack._covered[first], &stack._covered[first] + words, saved + words);
+
+    for (int w{}; w < words; w++) {
+        stack._interior[first + w] |= boards._interior[boards._offset[id] + w];
+        stack._covered[first + w] |= boards._covered[boards._offset[id] + w];
+    }
+}
+
+// Undo occupy(boards, stack, id, depth).
+void vacate(const placement_bitboards& boards, search_stack& stack, int id, int depth) {
+    size_t first = size_t(boards._bottom[id]) * boards._row_words;
+    int words = (boards._top[id] - boards._bottom[id]) * boards._row_words;
+    const uint64_t* saved = stack.saved(depth);
+    std::copy(saved, saved + words, &stack._interior[first]);
+    std::copy(saved + words, saved + 2 * words, &stack._covered[first]);
+}
+
+bool place_candidate(const search_shared& shared, search_stack& stack, int id) {
+    const conflict_matrix& conflicts = shared.conflicts;
+    int depth = stack._depth;
+
+    if (shared.mode == search_mode::static_order) {
+        uint64_t* placed = stack.level(0);
+        if (stack._stats) stack._stats->tried[stack._triangle[depth]]++;
+
+        int verdict = conflicts._bitboards.compare_occupied(id, stack._interior.data(), stack._covered.data());
+        if (verdict > 0 || (verdict < 0 && conflicts.conflicts_with(id, placed))) {
+            if (stack._stats || shared.backjumping) {
+                const uint64_t* bits = conflicts.row(id);
+                int d = 0;
+                while (!(bits[stack._ids[d] / 64] >> (stack._ids[d] % 64) & 1)) d++;
+                if (stack._stats) count_prune(shared, *stack._stats, id, stack._ids[d]);
+                if (shared.backjumping) stack.blame(depth, d);
+            }
+            return false;
+        }
+        if (shared.nogood_capacity && completes_nogood(stack, id)) return false;
+
+        placed[id / 64] |= uint64_t(1) << (id % 64);
+        occupy(conflicts._bitboards, stack, id, depth);
+        stack._placed_at[id] = depth;
+        return true;
+    }
+
+    const uint64_t* alive = stack.level(depth);
+    if (!(alive[id / 64] >> (id % 64) & 1)) return false;
+    if (stack._stats) stack._stats->tried[stack._triangle[depth]]++;
+    if (shared.nogood_capacity && completes_nogood(stack, id)) return false;
+
+    const uint64_t* bits = conflicts.row(id);
+    uint64_t* next = stack.level(depth + 1);
+    for (int w{}; w < stack._words; w++) {
+        next[w] = alive[w] & ~bits[w];
+    }
+    int index = stack._triangle[depth];
+    clear_range(next, conflicts._first[index], conflicts._first[index + 1]);
+
+    for (int k{}; k < shared.board.size(); k++) {
+        if (!stack._assigned[k] && count_in_range(next, conflicts._first[k], conflicts._first[k + 1]) == 0) {
+            if (stack._stats) stack._stats->pruned[prune_emptied_domain]++;
+            if (shared.backjumping) blame_pruners(shared, stack, k, depth);
+            return false;
+        }
+    }
+
+    if (stack._stats) {
+        for (int w{}; w < stack._words; w++) {
+            for (uint64_t removed = alive[w] & bits[w]; removed; removed &= removed - 1) {
+                count_prune(shared, *stack._stats, w * 64 + __builtin_ctzll(removed), id);
+            }
+        }
+    }
+    stack._placed_at[id] = depth;
+    return true;
+}
+
+// Take placement `id`, placed at stack._depth, back off the board. Only static_order needs anything doing.
+void remove_candidate(const search_shared& shared, search_stack& stack, int id) {
+    if (shared.mode == search_mode::static_order) {
+        stack.level(0)[id / 64] &= ~(uint64_t(1) << (id % 64));
+        vacate(shared.conflicts._bitboards, stack, id, stack._depth);
+    }
+}
+
+/*
+ *  Load task.prefix onto the stack: the placed set and occupied squares (static_order), or the alive set at every
+ *  level of the prefix (forward_checking). Returns how many of the prefix's placements had a choice, that is, were
+ *  made with more than one candidate for the triangle, which is how far the task's ancestors split the tree.
+ */
+
+int load_prefix(const search_shared& shared, search_stack& stack, const search_task& task) {
+    const conflict_matrix& conflicts = shared.conflicts;
+    int choices = 0;
+
+    std::fill(stack._assigned.begin(), stack._assigned.end(), false);
+    uint64_t* first = stack.level(0);
+    if (shared.mode == search_mode::static_order) {
+        std::fill(first, first + stack._words, 0);
+        std::fill(stack._interior.begin(), stack._interior.end(), 0);
+        std::fill(stack._covered.begin(), stack._covered.end(), 0);
+    } else {
+        std::fill(first, first + stack._words, ~uint64_t(0));
+        if (conflicts._total % 64) first[stack._words - 1] >>= 64 - conflicts._total % 64;
+    }
+
+    for (stack._depth = 0; stack._depth < task.prefix.size(); stack._depth++) {
+        int id = task.prefix[stack._depth];
+        int index = conflicts.triangle_of(id);
+
+        stack._ids[stack._depth] = id;
+        stack._triangle[stack._depth] = index;
+        stack._assigned[index] = true;
+        stack._placed_at[id] = stack._depth;
+
+        int from = conflicts._first[index], to = conflicts._first[index + 1];
+        if (shared.mode == search_mode::static_order ? to - from > 1 : count_in_range(stack.level(stack._depth), from, to) > 1) {
+            choices++;
+        }
+
+        if (shared.mode == search_mode::static_order) {
+            first[id / 64] |= uint64_t(1) << (id % 64);
+            occupy(conflicts._bitboards, stack, id, stack._depth);
+        } else {
+            const uint64_t* alive = stack.level(stack._depth);
+            const uint64_t* bits = conflicts.row(id);
+            uint64_t* next = stack.level(stack._depth + 1);
+            for (int w{}; w < stack._words; w++) {
+                next[w] = alive[w] & ~bits[w];
+            }
+            clear_range(next, from, to);
+        }
+    }
+    return choices;
+}
+
+/*
+ *  Depth-first search of every completion of task.prefix, as a loop over the stack rather than recursion.
+ *
+ *  Until split_depth placements with a choice are on the board, the surviving candidates of a depth with more than
+ *  one aren't searched here; each one becomes a task of its own, which this worker will pick up next unless another
+ *  worker steals it first. They are pushed last candidate first so that they come back off the deque in the order
+ *  open_level put them in. A depth with a single candidate is searched in the task itself, so the forced placements
+ *  forward_checking makes first don't use up the split.
+ *
+ *  With backjumping, a depth that runs out of candidates backs up to the deepest depth in its culprits, which
+ *  inherits the rest of them: nothing in between can make a difference, since every candidate was ruled out by
+ *  placements at or above that depth. Those placements are a nogood, and go in the worker's cache (unless a
+ *  solution was found below, in which case they aren't). Finding a solution makes every depth blame every depth
+ *  above it, so that the search backs up one depth at a time from there and enumerating misses nothing. Backing
+ *  up past the task's own first depth means the rest of the task can't have a solution either.
+ *
+ *  When a checkpoint is due, the worker hands over what's left of the task before going on: the untried candidates
+ *  at each depth from the task's first down, and everything below where it has got to.
+ *
+ *  Returns false if the run used up its restart budget and was abandoned, true otherwise.
+ */
+
+// Let the progress reporter know about a node at `depth`, in batches so the workers don't fight over the counter.
+void sample_progress(search_shared& shared, search_stack& stack, int depth) {
+    if (depth > stack._deepest) {
+        stack._deepest = depth;
+        int deepest = shared.deepest.load(std::memory_order_relaxed);
+        while (depth > deepest && !shared.deepest.compare_exchange_weak(deepest, depth, std::memory_order_relaxed)) {}
+    }
+    if (++stack._unpublished == 1024) {
+        shared.sampled_nodes.fetch_add(stack._unpublished, std::memory_order_relaxed);
+        stack._unpublished = 0;
+    }
+}
+
+// The depth to back up to from exhausted `depth`, or -1 for none, having learned what there is to learn.
+int jump_target(const search_shared& shared, search_stack& stack, int depth) {
+    uint64_t* culprits = stack.culprits(depth);
+    int target = -1;
+    for (int w = stack._depth_words - 1; w >= 0 && target < 0; w--) {
+        if (culprits[w]) target = w * 64 + 63 - __builtin_clzll(culprits[w]);
+    }
+
+    if (shared.nogood_capacity && !stack._below_solution[depth] && target >= 0) {
+        int ids[nogood_cache::nogood_size];
+        int count = 0;
+        for (int w{}; w < stack._depth_words && count <= nogood_cache::nogood_size; w++) {
+            for (uint64_t word = culprits[w]; word && count <= nogood_cache::nogood_size; word &= word - 1) {
+                if (count < nogood_cache::nogood_size) ids[count] = stack._ids[w * 64 + __builtin_ctzll(word)];
+                count++;
+            }
+        }
+        if (count <= nogood_cache::nogood_size) {
+            stack._nogoods.add(ids, count);
+            if (stack._stats) stack._stats->nogoods++;
+        }
+    }
+    if (target < 0) return -1;
+
+    culprits[target / 64] &= ~(uint64_t(1) << (target % 64));
+    uint64_t* inherited = stack.culprits(target);
+    for (int w{}; w < stack._depth_words; w++) inherited[w] |= culprits[w];
+    stack._below_solution[target] = stack._below_solution[target] || stack._below_solution[depth];
+    if (stack._stats && target < depth - 1) stack._stats->backjumps++;
+    return target;
+}
+
+// After a solution: every depth blames every depth above it, and has a solution below it.
+void blame_everything(search_stack& stack, int triangles) {
+    for (int d{}; d < triangles; d++) {
+        uint64_t* culprits = stack.culprits(d);
+        for (int w{}; w < stack._depth_words; w++) {
+            culprits[w] = d >= 64 * (w + 1) ? ~uint64_t(0) : d > 64 * w ? ~uint64_t(0) >> (64 - (d - 64 * w)) : 0;
+        }
+        stack._below_solution[d] = true;
+    }
+}
+
+// Add what's left of `task` to `left`, for a worker that is about to enter a node at stack._depth.
+void remaining_tasks(search_stack& stack, const search_task& task, int base, vector<search_task>& left) {
+    for (int depth = base; depth < stack._depth; depth++) {
+        if (stack._cursor[depth] == stack._count[depth]) continue;
+        const int* order = stack.order(depth);
+        left.push_back(search_task{vector<int>(stack._ids.begin(), stack._ids.begin() + depth),
+                                   vector<int>(order + stack._cursor[depth], order + stack._count[depth])});
+    }
+    if (stack._depth == base) {
+        left.push_back(task);
+    } else {
+        left.push_back(search_task{vector<int>(stack._ids.begin(), stack._ids.begin() + stack._depth), {}});
+    }
+}
+
+// Hand `left` over for the checkpoint being taken, if there still is one, and wait until it has been written.
+void pause_for_checkpoint(search_shared& shared, vector<search_task>& left) {
+    std::unique_lock<std::mutex> lock(shared.checkpoint_mutex);
+    if (!shared.checkpoint_due.load()) return;
+
+    uint64_t round = shared.checkpoint_round;
+    shared.frontier.insert(shared.frontier.end(), left.begin(), left.end());
+    shared.paused++;
+    shared.checkpoint_changed.notify_all();
+    shared.checkpoint_changed.wait(lock, [&]() { return shared.checkpoint_round != round; });
+}
+
+bool run_task(search_shared& shared, int worker, search_stack& stack, const search_task& task) {
+    const int triangles = shared.board.size();
+
+    const bool splitting = load_prefix(shared, stack, task) < shared.split_depth;
+    const int base = stack._depth;
+    if (stack._stats) stack._stats->tasks++;
+    bool entering = true;
+    stack._spent = 0;
+
+    while (!shared.stopped()) {
+        int depth = stack._depth;
+
+        if (entering) {
+            entering = false;
+
+            if (shared.checkpoint_due.load(std::memory_order_relaxed)) {
+                vector<search_task> left;
+                remaining_tasks(stack, task, base, left);
+                pause_for_checkpoint(shared, left);
+            }
+            if (shared.restart_nodes && stack._spent++ == stack._budget) return false;
+            if (stack._stats) stack._stats->nodes[depth]++;
+            if (shared.progress) sample_progress(shared, stack, depth);
+
+            if (depth == triangles) {
+                shared.record_solution(stack._ids);
+                if (shared.backjumping) blame_everything(stack, triangles);
+                if (depth == base) return true;
+                stack._depth--;
+                remove_candidate(shared, stack, stack._ids[stack._depth]);
+                continue;
+            }
+
+            open_level(shared, stack, depth == base ? task.choices : vector<int>());
+
+            if (splitting && stack._count[depth] > 1) {
+                const int* order = stack.order(depth);
+                for (int n = stack._count[depth] - 1; n >= 0; n--) {
+                    int id = order[n];
+                    if (!place_candidate(shared, stack, id)) continue;
+                    remove_candidate(shared, stack, id);
+
+                    search_task child{vector<int>(stack._ids.begin(), stack._ids.begin() + depth), {}};
+                    child.prefix.push_back(id);
+                    shared.pool.push(worker, std::move(child));
+                }
+
+                // Every depth of the task above this one had a single candidate, so the children are all that's
+                // left of it. Backing up through them instead would blame them, and learn nogoods, for subtrees
+                // nobody has searched yet.
+                return true;
+            }
+        }
+
+        int index = stack._triangle[depth];
+        const int* order = stack.order(depth);
+        int end = stack._count[depth];
+        int& cursor = stack._cursor[depth];
+        while (cursor < end && !place_candidate(shared, stack, order[cursor])) cursor++;
+
+        if (cursor < end) {
+            stack._ids[depth] = order[cursor++];
+            stack._depth++;
+            entering = true;
+            continue;
+        }
+
+        // Every candidate at this depth has been tried: back up one level, or further with backjumping.
+        stack._assigned[index] = false;
+        if (depth == base) return true;
+        int target = shared.backjumping ? jump_target(shared, stack, depth) : depth - 1;
+        if (target < base) return true;
+
+        for (stack._depth = depth - 1; ; stack._depth--) {
+            remove_candidate(shared, stack, stack._ids[stack._depth]);
+            if (stack._depth == target) break;
+            stack._assigned[stack._triangle[stack._depth]] = false;
+        }
+    }
+    return true;
+}
+
+// The i-th term, counting from 1, of the Luby sequence: 1 1 2 1 1 2 4 1 1 2 1 1 2 4 8 ...
+uint64_t luby(uint64_t i) {
+    for (;;) {
+        int k = 1;
+        while ((uint64_t(1) << k) - 1 < i) k++;
+        if (i == (uint64_t(1) << k) - 1) return uint64_t(1) << (k - 1);
+        i -= (uint64_t(1) << (k - 1)) - 1;
+    }
+}
+
+void search_worker(search_shared& shared, int worker, search_stack& stack) {
+    search_stats stats;
+    stats.reset(shared.board.size());
+    const placement_bitboards& boards = shared.conflicts._bitboards;
+    int domain = 0;
+    for (int k{}; k < shared.board.size(); k++) {
+        domain = std::max(domain, shared.conflicts._first[k + 1] - shared.conflicts._first[k]);
+    }
+    stack.reset(shared.board.size(), shared.conflicts._words, domain, boards._height * boards._row_words,
+                shared.conflicts._total, shared.nogood_capacity, shared.stats ? &stats : nullptr);
+    if (shared.seed) stack._random.seed(shared.seed + worker);
+    stack._budget = shared.restart_nodes * luby(++stack._runs);
+    search_task task;
+
+    while (!shared.stopped()) {
+        uint64_t seen = shared.pool.signals();
+        if (!shared.pool.pop(worker, task)) {
+            if (shared.pool.idle()) break;
+            if (shared.checkpoint_due.load(std::memory_order_relaxed)) {
+                vector<search_task> nothing;
+                pause_for_checkpoint(shared, nothing);
+                continue;
+            }
+            shared.pool.wait(seen);
+            continue;
+        }
+
+        if (!run_task(shared, worker, stack, task)) {
+            stats.restarts++;
+            stack._budget = shared.restart_nodes * luby(++stack._runs);
+            shared.pool.push(worker, search_task{});
+        }
+        shared.pool.task_done();
+    }
+
+    shared.sampled_nodes.fetch_add(stack._unpublished, std::memory_order_relaxed);
+    if (shared.stats) {
+        std::lock_guard<std::mutex> lock(shared.stats_mutex);
+        shared.stats->merge(stats);
+    }
+
+    std::lock_guard<std::mutex> lock(shared.checkpoint_mutex);
+    shared.active--;
+    shared.checkpoint_changed.notify_all();
+}
+
+/*
+ *  Every `seconds`, until `done` is set, print how far the search has got to std::cerr. The numbers are samples:
+ *  the workers only publish their node counts every so often.
+ */
+
+void report_progress(search_shared& shared, double seconds, std::mutex& mutex, std::condition_variable& finished,
+                     const bool& done) {
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (!finished.wait_for(lock, std::chrono::duration<double>(seconds), [&]() { return done; })) {
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        uint64_t nodes = shared.sampled_nodes.load(std::memory_order_relaxed);
+        std::cerr << "progress: " << elapsed << "s, " << nodes << " nodes (" << uint64_t(nodes / elapsed)
+                  << "/s), deepest " << shared.deepest.load(std::memory_order_relaxed) << " of " << shared.board.size()
+                  << ", " << shared.pool.pending() << " tasks left\n";
+    }
+}
+
+/*
+ *  Pause the workers and fill `checkpoint` with what they have left, the tasks waiting in the pool, and the
+ *  solutions found so far. False, with nothing filled in, if every worker has already finished.
+ */
+
+bool take_checkpoint(search_shared& shared, search_checkpoint& checkpoint) {
+    std::unique_lock<std::mutex> lock(shared.checkpoint_mutex);
+    shared.checkpoint_due.store(true);
+    shared.pool.wake();
+    shared.checkpoint_changed.wait(lock, [&]() { return shared.paused == shared.active; });
+
+    bool taken = shared.active > 0;
+    if (taken) {
+        checkpoint.fingerprint = placement_fingerprint(shared.board);
+        checkpoint.mode = shared.mode;
+        checkpoint.solutions = shared.solutions.load();
+        {
+            std::lock_guard<std::mutex> solution_lock(shared.solution_mutex);
+            checkpoint.first_solution = shared.solution_ids;
+        }
+        checkpoint.tasks = std::move(shared.frontier);
+        shared.pool.snapshot(checkpoint.tasks);
+    }
+
+    shared.frontier.clear();
+    shared.paused = 0;
+    shared.checkpoint_due.store(false);
+    shared.checkpoint_round++;
+    shared.checkpoint_changed.notify_all();
+    return taken;
+}
+
+// Every `seconds`, until `done` is set, save a checkpoint to `path`.
+void write_checkpoints(search_shared& shared, const std::string& path, double seconds, std::mutex& mutex,
+                       std::condition_variable& finished, const bool& done) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (!finished.wait_for(lock, std::chrono::duration<double>(seconds), [&]() { return done; })) {
+        lock.unlock();
+        search_checkpoint checkpoint;
+        if (take_checkpoint(shared, checkpoint) && !save_checkpoint(path, checkpoint)) {
+            std::cerr << path << ": cannot write the checkpoint\n";
+        }
+        lock.lock();
+    }
+}
+
+}
+
+/*
+ *  Search the board on options.threads workers, splitting the tree into tasks for the first options.split_depth
+ *  placements. Returns how many solutions were found (no more than options.limit, if that is set), counting any
+ *  a resumed checkpoint had found already, and fills solution_ids with the first found, by this search or the one
+ *  the checkpoint came from. If `stats` is given, it is filled in with what the search did.
+ *  If `workspace` is given, the workers' stacks come from it and stay in it afterwards.
+ */
+
+uint64_t parallel_solution(const vector<Triangle>& board, const conflict_matrix& conflicts, const search_options& options,
+                           vector<int>& solution_ids, search_stats* stats, search_workspace* workspace) {
+    search_shared shared(board, conflicts, options, stats);
+    if (stats) stats->reset(board.size());
+    if (!options.resume) {
+        shared.pool.push(0, search_task{});
+    } else {
+        shared.solutions.store(options.resume->solutions);
+        shared.solution_ids = options.resume->first_solution;
+        if (!options.limit || options.resume->solutions < options.limit) {
+            for (int t{}; t < options.resume->tasks.size(); t++) {
+                shared.pool.push(t % shared.workers, options.resume->tasks[t]);
+            }
+        }
+    }
+
+    std::mutex progress_mutex;
+    std::condition_variable finished;
+    bool done = false;
+    std::thread reporter, checkpointer;
+    if (shared.progress) {
+        reporter = std::thread(report_progress, std::ref(shared), options.progress_seconds, std::ref(progress_mutex),
+                               std::ref(finished), std::cref(done));
+    }
+    if (!options.checkpoint_path.empty()) {
+        checkpointer = std::thread(write_checkpoints, std::ref(shared), std::cref(options.checkpoint_path),
+                                   options.checkpoint_seconds, std::ref(progress_mutex), std::ref(finished),
+                                   std::cref(done));
+    }
+
+    search_workspace local;
+    vector<search_stack>& stacks = (workspace ? *workspace : local)._stacks;
+    if (stacks.size() < shared.workers) stacks.resize(shared.workers);
+
+    vector<std::thread> workers;
+    for (int worker = 1; worker < shared.workers; worker++) {
+        workers.emplace_back(search_worker, std::ref(shared), worker, std::ref(stacks[worker]));
+    }
+    search_worker(shared, 0, stacks[0]);
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(progress_mutex);
+        done = true;
+    }
+    finished.notify_all();
+    if (reporter.joinable()) reporter.join();
+    if (checkpointer.joinable()) checkpointer.join();
+
+    solution_ids = shared.solution_ids;
+    uint64_t found = shared.solutions.load();
+    return options.limit ? std::min(found, options.limit) : found;
+}
+
+/*
+ *  Strategies 2 and up take turns at forward_checking and static_order, with and without value_order, and
+ *  restart on a Luby schedule whose unit doubles every four strategies, from 128 nodes up to 1024 and round again.
+ */
+
+vector<search_options> default_portfolio(int count, uint64_t seed) {
+    vector<search_options> strategies(count);
+    for (int i{}; i < count; i++) {
+        search_options& strategy = strategies[i];
+        if (i == 1) strategy.mode = search_mode::static_order;
+        if (i < 2) continue;
+
+        int j = i - 2;
+        strategy.mode = j % 2 ? search_mode::static_order : search_mode::forward_checking;
+        strategy.value_order = j / 2 % 2 == 0;
+        strategy.seed = seed + i;
+        strategy.restart_nodes = uint64_t(128) << (j / 4 % 4);
+    }
+    return strategies;
+}
+
+/*
+ *  Run every strategy on a thread of its own, each a parallel_solution for the first solution. Each strategy's
+ *  limit, sink and stop are overridden; whichever finishes first raises the portfolio's own stop for the rest.
+ *  Returns 1, with the solution in solution_ids, if there is a solution and 0 if there isn't, and sets `winner`
+ *  to the strategy that found out (-1 with no strategies). If `stats` is given it gets each strategy's own.
+ */
+
+uint64_t portfolio_solution(const vector<Triangle>& board, const conflict_matrix& conflicts,
+                            const vector<search_options>& strategies, vector<int>& solution_ids, int& winner,
+                            vector<search_stats>* stats) {
+    std::atomic<bool> stop(false);
+    std::atomic<int> settled(-1);
+    vector<uint64_t> found(strategies.size());
+    vector<vector<int>> found_ids(strategies.size());
+    if (stats) stats->assign(strategies.size(), search_stats());
+
+    vector<std::thread> threads;
+    for (int s{}; s < strategies.size(); s++) {
+        threads.emplace_back([&, s]() {
+            search_options options = strategies[s];
+            options.limit = 1;
+            options.sink = nullptr;
+            options.stop = &stop;
+            found[s] = parallel_solution(board, conflicts, options, found_ids[s], stats ? &(*stats)[s] : nullptr);
+
+            // A search that was stopped has lost already; one that wasn't has the answer.
+            int none = -1;
+            if (settled.compare_exchange_strong(none, s)) stop.store(true);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    winner = settled.load();
+    if (winner < 0) return 0;
+    solution_ids = found_ids[winner];
+    return found[winner];
+}
+
+////////////////////////////////////
+//       Search Statistics        //
+////////////////////////////////////
+
+void search_stats::reset(int triangles) {
+    nodes.assign(triangles + 1, 0);
+    tried.assign(triangles, 0);
+    std::fill(pruned, pruned + prune_reasons, 0);
+    backjumps = 0;
+    nogoods = 0;
+    restarts = 0;
+    tasks = 0;
+}
+
+void search_stats::merge(const search_stats& other) {
+    for (int d{}; d < nodes.size(); d++) nodes[d] += other.nodes[d];
+    for (int k{}; k < tried.size(); k++) tried[k] += other.tried[k];
+    for (int r{}; r < prune_reasons; r++) pruned[r] += other.pruned[r];
+    backjumps += other.backjumps;
+    nogoods += other.nogoods;
+    restarts += other.restarts;
+    tasks += other.tasks;
+}
+
+uint64_t search_stats::total_nodes() const {
+    uint64_t total = 0;
+    for (uint64_t count : nodes) total += count;
+    return total;
+}
+
+void print_stats(std::ostream& out, const vector<Triangle>& board, const search_stats& stats) {
+    out << "Nodes: " << stats.total_nodes() << "\n";
+    for (int d{}; d < stats.nodes.size(); d++) {
+        out << "  depth " << d << ": " << stats.nodes[d] << "\n";
+    }
+
+    const char* reasons[prune_reasons] = { "edge crossing", "contained in", "contains", "emptied a domain", "nogood" };
+    out << "Pruned:\n";
+    for (int r{}; r < prune_reasons; r++) {
+        out << "  " << reasons[r] << ": " << stats.pruned[r] << "\n";
+    }
+    out << "Backjumps: " << stats.backjumps << "\n";
+    out << "Nogoods learned: " << stats.nogoods << "\n";
+    out << "Restarts: " << stats.restarts << "\n";
+    out << "Tasks: " << stats.tasks << "\n";
+
+    out << "Candidates tried:\n";
+    for (int k{}; k < stats.tried.size(); k++) {
+        out << "  triangle " << k << " (area " << board[k].getArea() << " at " << board[k].getXC() << ","
+            << board[k].getYC() << "): " << stats.tried[k] << "\n";
+    }
+}
+
+// How many duplicate placements make_combinations dropped, in all and for each clue that had any.
+void print_duplicates(std::ostream& out, const vector<Triangle>& board) {
+    int total = 0;
+    for (const Triangle& triangle : board) total += triangle.getDuplicates();
+    out << "Duplicate placements removed: " << total << "\n";
+    for (int k{}; k < board.size(); k++) {
+        if (!board[k].getDuplicates()) continue;
+        out << "  triangle " << k << " (area " << board[k].getArea() << " at " << board[k].getXC() << ","
+            << board[k].getYC() << "): " << board[k].getDuplicates() << "\n";
+    }
+}
+
+// One line per strategy: how it was configured and what it did.
+void print_portfolio_stats(std::ostream& out, const vector<search_options>& strategies,
+                           const vector<search_stats>& stats, int winner) {
+    for (int s{}; s < strategies.size(); s++) {
+        const search_options& strategy = strategies[s];
+        out << "Strategy " << s << " (" << (strategy.mode == search_mode::static_order ? "static" : "fc")
+            << (strategy.value_order ? ", value order" : "") << (strategy.backjumping ? ", backjumping" : "");
+        if (strategy.seed) out << ", seed " << strategy.seed;
+        if (strategy.restart_nodes) out << ", restarts every " << strategy.restart_nodes << " x luby";
+        out << "): " << stats[s].total_nodes() << " nodes, " << stats[s].restarts << " restarts, "
+            << stats[s].backjumps << " backjumps, " << stats[s].nogoods << " nogoods" << (s == winner ? ", won" : "")
+            << "\n";
+    }
+}
+
+////////////////////////////////////
+//         Puzzle Files           //
+////////////////////////////////////
+
+namespace {
+
+// Read the next integer from `in`, skipping whitespace and comments. False at the end of the file or on garbage.
+bool read_number(std::istream& in, int& value) {
+    while (in >> std::ws && in.peek() == '#') {
+        in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    return bool(in >> value);
+}
+
+}
+
+/*
+ *  Stream a puzzle in from `in`, building each clue's Triangle as soon as it is read.
+ *  On a malformed file, returns false and says what is wrong in `error`.
+ */
+
+int max_clue_area(int width, int height) {
+    return int(int64_t(width) * height / 2);
+}
+
+bool read_puzzle(std::istream& in, puzzle& loaded, std::string& error) {
+    loaded._board.clear();
+
+    if (!read_number(in, loaded._width) || !read_number(in, loaded._height)) {
+        error = "expected the board's width and height";
+        return false;
+    }
+    if (loaded._width < 1 || loaded._height < 1) {
+        error = "the board must be at least 1 by 1";
+        return false;
+    }
+    if (loaded._width > std::numeric_limits<int16_t>::max() || loaded._height > std::numeric_limits<int16_t>::max()) {
+        error = "the board can be at most " + std::to_string(std::numeric_limits<int16_t>::max()) + " squares a side";
+        return false;
+    }
+
+    int area, x, y;
+    while (read_number(in, area)) {
+        std::string clue = "clue " + std::to_string(loaded._board.size() + 1);
+        if (!read_number(in, x) || !read_number(in, y)) {
+            error = clue + ": expected an area, x and y";
+            return false;
+        }
+        if (area < 1) {
+            error = clue + ": the area must be at least 1";
+            return false;
+        }
+        if (area > max_clue_area(loaded._width, loaded._height)) {
+            error = clue + ": the area can be at most " +
+                    std::to_string(max_clue_area(loaded._width, loaded._height)) + " on this board";
+            return false;
+        }
+        if (x < 0 || x >= loaded._width || y < 0 || y >= loaded._height) {
+            error = clue + ": square (" + std::to_string(x) + "," + std::to_string(y) + ") is off the board";
+            return false;
+        }
+        loaded._board.emplace_back(area, x, y, loaded._width, loaded._height);
+    }
+
+    if (!in.eof()) {
+        error = "clue " + std::to_string(loaded._board.size() + 1) + ": expected an integer";
+        return false;
+    }
+    if (loaded._board.empty()) {
+        error = "the puzzle has no clues";
+        return false;
+    }
+    return true;
+}
+
+void write_subproblem(std::ostream& out, const vector<Triangle>& board, const conflict_matrix& conflicts,
+                      const uint64_t* domains) {
+    out << board[0].getWidth() << " " << board[0].getHeight() << "\n";
+    for (int k{}; k < board.size(); k++) {
+        const placement_list& candidates = board[k].all_triangles;
+        int first = conflicts._first[k];
+        out << board[k].getArea() << " " << board[k].getXC() << " " << board[k].getYC() << " "
+            << count_in_range(domains, first, conflicts._first[k + 1]) << "\n";
+
+        for (int id = first; id < conflicts._first[k + 1]; id++) {
+            if (!(domains[id / 64] >> (id % 64) & 1)) continue;
+            Point a = candidates.a(id - first), b = candidates.b(id - first), c = candidates.c(id - first);
+            out << "  " << a.x << " " << a.y << " " << b.x << " " << b.y << " " << c.x << " " << c.y << "\n";
+        }
+    }
+}
+
+/*
+ *  Like read_puzzle, but each clue's candidates are the ones listed rather than every one it could have.
+ */
+
+bool read_subproblem(std::istream& in, puzzle& loaded, std::string& error) {
+    loaded._board.clear();
+
+    if (!read_number(in, loaded._width) || !read_number(in, loaded._height)) {
+        error = "expected the board's width and height";
+        return false;
+    }
+    if (loaded._width < 1 || loaded._height < 1 || loaded._width > std::numeric_limits<int16_t>::max() ||
+        loaded._height > std::numeric_limits<int16_t>::max()) {
+        error = "the board must be from 1 to " + std::to_string(std::numeric_limits<int16_t>::max()) + " squares a side";
+        return false;
+    }
+
+    int area, x, y, count;
+    while (read_number(in, area)) {
+        std::string clue = "clue " + std::to_string(loaded._board.size() + 1);
+        if (!read_number(in, x) || !read_number(in, y) || !read_number(in, count)) {
+            error = clue + ": expected an area, x, y and candidate count";
+            return false;
+        }
+        if (area < 1 || area > max_clue_area(loaded._width, loaded._height) || x < 0 || x >= loaded._width || y < 0 || y >= loaded._height || count < 0) {
+            error = clue + ": not a clue on this board";
+            return false;
+        }
+
+        // Every candidate must be one the clue's Triangle generates for itself, so a cube can narrow a clue's
+        // candidates down but never slip in a triangle of the wrong area or one that misses the clue's square.
+        loaded._board.emplace_back(area, x, y, loaded._width, loaded._height);
+        placement_list& candidates = loaded._board.back().all_triangles;
+        std::unordered_set<uint64_t> generated(candidates.size());
+        for (int i{}; i < candidates.size(); i++) {
+            generated.insert(placement_key(candidates._ax[i], candidates._ay[i], candidates._bx[i], candidates._by[i],
+                                           candidates._cx[i], candidates._cy[i]));
+        }
+        candidates.clear();
+        for (int i{}; i < count; i++) {
+            int vertex[6];
+            for (int v{}; v < 6; v++) {
+                int limit = v % 2 ? loaded._height : loaded._width;
+                if (!read_number(in, vertex[v]) || vertex[v] < 0 || vertex[v] > limit) {
+                    error = clue + ": candidate " + std::to_string(i + 1) + " needs six coordinates on the board";
+                    return false;
+                }
+            }
+            if (!generated.count(placement_key(vertex[0], vertex[1], vertex[2], vertex[3], vertex[4], vertex[5]))) {
+                error = clue + ": candidate " + std::to_string(i + 1) + " isn't a placement of this clue";
+                return false;
+            }
+            candidates.push_back(vertex[0], vertex[1], vertex[2], vertex[3], vertex[4], vertex[5]);
+        }
+    }
+
+    if (!in.eof()) {
+        error = "clue " + std::to_string(loaded._board.size() + 1) + ": expected an integer";
+        return false;
+    }
+    if (loaded._board.empty()) {
+        error = "the subproblem has no clues";
+        return false;
+    }
+    return true;
+}
+
+/*
+ *  The board as provided in the puzzle: 17 by 17 with 29 triangles.
+ */
+
+puzzle published_puzzle() {
+    puzzle published{17, 17, {}};
+
+    const int clues[][3] = { {2,3,0}, {18,7,0}, {12,2,1}, {4,13,1}, {3,4,2}, {7,11,2},
+                             {6,16,2}, {6,0,3}, {9,3,4}, {11,9,4}, {8,14,5}, {4,0,6},
+                             {14,5,6}, {18,15,6}, {20,8,8}, {7,1,10}, {3,11,10},
+                             {3,16,10}, {3,2,11}, {7,7,12}, {10,13,12}, {5,16,13},
+                             {4,0,14}, {10,5,14}, {3,12,14},  {12,3,15}, {7,14,15},
+                             {8,9,16}, {2,13,16} };
+
+    for (const auto& clue : clues) {
+        published._board.emplace_back(clue[0], clue[1], clue[2], published._width, published._height);
+    }
+    return published;
+}
+
+////////////////////////////////////
+//          Checkpoints           //
+////////////////////////////////////
+
+// A hash of every triangle's candidates in ID order, so that a checkpoint is only resumed on the board it came from.
+uint64_t placement_fingerprint(const vector<Triangle>& board) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const Triangle& triangle : board) {
+        const placement_list& candidates = triangle.all_triangles;
+        hash = (hash ^ uint64_t(candidates.size())) * 1099511628211ull;
+        for (int i{}; i < candidates.size(); i++) {
+            uint64_t key = placement_key(candidates._ax[i], candidates._ay[i], candidates._bx[i], candidates._by[i],
+                                         candidates._cx[i], candidates._cy[i]);
+            hash = (hash ^ key) * 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+void write_checkpoint(std::ostream& out, const search_checkpoint& checkpoint) {
+    out << "tritri-checkpoint " << checkpoint.fingerprint << " "
+        << (checkpoint.mode == search_mode::static_order ? "static" : "fc") << " " << checkpoint.solutions << " "
+        << checkpoint.tasks.size() << "\n";
+    out << checkpoint.first_solution.size();
+    for (int id : checkpoint.first_solution) out << " " << id;
+    out << "\n";
+    for (const search_task& task : checkpoint.tasks) {
+        out << task.prefix.size();
+        for (int id : task.prefix) out << " " << id;
+        out << " " << task.choices.size();
+        for (int id : task.choices) out << " " << id;
+        out << "\n";
+    }
+}
+
+/*
+ *  Whether `task` is one a search in `mode` could have left behind: its prefix has at most one placement of each
+ *  triangle (in static_order, one each of the first ones, in board order), no two of which conflict, and its
+ *  choices are different candidates of a single triangle that comes next (in static_order, the one after the
+ *  prefix). Anything else would have the search write past the end of its stack.
+ */
+
+bool valid_task(const conflict_matrix& conflicts, search_mode mode, const search_task& task) {
+    const int triangles = conflicts._first.size() - 1;
+    vector<char> placed(triangles, false);
+    for (int d{}; d < task.prefix.size(); d++) {
+        int index = conflicts.triangle_of(task.prefix[d]);
+        if (placed[index] || (mode == search_mode::static_order && index != d)) return false;
+        placed[index] = true;
+        for (int e{}; e < d; e++) {
+            if (conflicts.row(task.prefix[d])[task.prefix[e] / 64] >> (task.prefix[e] % 64) & 1) return false;
+        }
+    }
+
+    if (task.choices.empty()) return true;
+    int index = conflicts.triangle_of(task.choices[0]);
+    if (placed[index] || (mode == search_mode::static_order && index != task.prefix.size())) return false;
+    vector<int> choices = task.choices;
+    std::sort(choices.begin(), choices.end());
+    return std::adjacent_find(choices.begin(), choices.end()) == choices.end() &&
+           conflicts.triangle_of(choices.back()) == index && choices.front() >= conflicts._first[index];
+}
+
+bool read_checkpoint(std::istream& in, const vector<Triangle>& board, const conflict_matrix& conflicts,
+                     search_mode mode, search_checkpoint& checkpoint, std::string& error) {
+    std::string magic, searched;
+    size_t tasks;
+    if (!(in >> magic >> checkpoint.fingerprint >> searched >> checkpoint.solutions >> tasks) ||
+        magic != "tritri-checkpoint" || (searched != "fc" && searched != "static")) {
+        error = "not a checkpoint";
+        return false;
+    }
+    if (checkpoint.fingerprint != placement_fingerprint(board)) {
+        error = "the checkpoint is for a different board";
+        return false;
+    }
+    checkpoint.mode = searched == "static" ? search_mode::static_order : search_mode::forward_checking;
+    if (checkpoint.mode != mode) {
+        error = "the checkpoint is for a search in --mode " + searched;
+        return false;
+    }
+
+    // The first solution has to be a whole one: a placement of every triangle, none of them in conflict.
+    size_t placed;
+    if (!(in >> placed) || (placed != 0 && placed != board.size()) || (checkpoint.solutions && !placed)) {
+        error = "the first solution is cut short";
+        return false;
+    }
+    checkpoint.first_solution.resize(placed);
+    vector<bool> covered(board.size(), false);
+    for (int n{}; n < placed; n++) {
+        int& id = checkpoint.first_solution[n];
+        if (!(in >> id) || id < 0 || id >= conflicts._total || covered[conflicts.triangle_of(id)]) {
+            error = "the first solution isn't one placement of each triangle";
+            return false;
+        }
+        covered[conflicts.triangle_of(id)] = true;
+        for (int m{}; m < n; m++) {
+            int other = checkpoint.first_solution[m];
+            if (conflicts.row(id)[other / 64] >> (other % 64) & 1) {
+                error = "the first solution has placements in conflict";
+                return false;
+            }
+        }
+    }
+
+    checkpoint.tasks.clear();
+    for (size_t t{}; t < tasks; t++) {
+        checkpoint.tasks.emplace_back();
+        for (vector<int>* ids : {&checkpoint.tasks[t].prefix, &checkpoint.tasks[t].choices}) {
+            size_t count;
+            if (!(in >> count) || count > board.size() + conflicts._total) {
+                error = "task " + std::to_string(t + 1) + " is cut short";
+                return false;
+            }
+            ids->resize(count);
+            for (int& id : *ids) {
+                if (!(in >> id) || id < 0 || id >= conflicts._total) {
+                    error = "task " + std::to_string(t + 1) + " has a placement that isn't on the board";
+                    return false;
+                }
+            }
+        }
+        if (!valid_task(conflicts, mode, checkpoint.tasks[t])) {
+            error = "task " + std::to_string(t + 1) + " isn't one the search could have left";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool save_checkpoint(const std::string& path, const search_checkpoint& checkpoint) {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        write_checkpoint(out, checkpoint);
+        out.flush();
+        if (!out) return false;
+    }
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+////////////////////////////////////
+//        Editing Sessions        //
+////////////////////////////////////
+
+session_clue::session_clue(int id, const Triangle& triangle)
+    : _id(id), _triangle(triangle), _covering(triangle.all_triangles.size(), 0), _left(0), _right(0), _bottom(0),
+      _top(0) {
+    const placement_list& candidates = _triangle.all_triangles;
+    if (!candidates.size()) return;
+    _left = std::min({*std::min_element(candidates._ax.begin(), candidates._ax.end()),
+                      *std::min_element(candidates._bx.begin(), candidates._bx.end()),
+                      *std::min_element(candidates._cx.begin(), candidates._cx.end())});
+    _right = std::max({*std::max_element(candidates._ax.begin(), candidates._ax.end()),
+                       *std::max_element(candidates._bx.begin(), candidates._bx.end()),
+                       *std::max_element(candidates._cx.begin(), candidates._cx.end())});
+    _bottom = std::min({*std::min_element(candidates._ay.begin(), candidates._ay.end()),
+                        *std::min_element(candidates._by.begin(), candidates._by.end()),
+                        *std::min_element(candidates._cy.begin(), candidates._cy.end())});
+    _top = std::max({*std::max_element(candidates._ay.begin(), candidates._ay.end()),
+                     *std::max_element(candidates._by.begin(), candidates._by.end()),
+                     *std::max_element(candidates._cy.begin(), candidates._cy.end())});
+    rasterise_placements(vector<Triangle>{_triangle}, _bitboards);
+}
+
+puzzle_session::puzzle_session(const puzzle& start) : _width(start._width), _height(start._height) {
+    for (const Triangle& triangle : start._board) {
+        _clues.emplace_back(_next_id++, triangle);
+    }
+    for (int i{}; i < _clues.size(); i++) {
+        cover(_clues[i]._triangle.getXC(), _clues[i]._triangle.getYC(), i, 1);
+        for (int k{}; k < i; k++) pair_up(i, k);
+    }
+}
+
+// The index in _clues of the clue on square (x, y), or -1 if there isn't one.
+int puzzle_session::find_clue(int x, int y) const {
+    for (int i{}; i < _clues.size(); i++) {
+        if (_clues[i]._triangle.getXC() == x && _clues[i]._triangle.getYC() == y) return i;
+    }
+    return -1;
+}
+
+// Add `change` to the covering count of every candidate of every clue but _clues[by] that covers square (x, y).
+void puzzle_session::cover(int x, int y, int by, int change) {
+    for (int i{}; i < _clues.size(); i++) {
+        session_clue& clue = _clues[i];
+        if (i == by || x < clue._left || x >= clue._right || y < clue._bottom || y >= clue._top) continue;
+        for (int j{}; j < clue._covering.size(); j++) {
+            if (covers_square(clue._triangle.all_triangles, j, x, y)) clue._covering[j] += change;
+        }
+    }
+}
+
+// Count the other clues' squares each candidate of _clues[index] covers, from scratch.
+void puzzle_session::count_covering(int index) {
+    session_clue& clue = _clues[index];
+    std::fill(clue._covering.begin(), clue._covering.end(), 0);
+    for (int k{}; k < _clues.size(); k++) {
+        int x = _clues[k]._triangle.getXC(), y = _clues[k]._triangle.getYC();
+        if (k == index || x < clue._left || x >= clue._right || y < clue._bottom || y >= clue._top) continue;
+        for (int j{}; j < clue._covering.size(); j++) {
+            if (covers_square(clue._triangle.all_triangles, j, x, y)) clue._covering[j]++;
+        }
+    }
+}
+
+// Work out which candidates of _clues[index] and _clues[other] conflict, as build_conflict_matrix would.
+void puzzle_session::pair_up(int index, int other) {
+    const session_clue* mine = &_clues[index];
+    const session_clue* theirs = &_clues[other];
+    if (mine->_id > theirs->_id) std::swap(mine, theirs);
+    if (mine->_right <= theirs->_left || theirs->_right <= mine->_left || mine->_top <= theirs->_bottom ||
+        theirs->_top <= mine->_bottom) {
+        return;
+    }
+
+    const placement_list& first = mine->_triangle.all_triangles;
+    const placement_list& second = theirs->_triangle.all_triangles;
+    const size_t words = (second.size() + 63) / 64;
+    vector<uint64_t> block(first.size() * words, 0);
+    bool any = false;
+    vector<int> hits;
+    for (int j{}; j < first.size(); j++) {
+        placements_conflicting(first, j, second, hits);
+        for (int l : hits) {
+            block[j * words + l / 64] |= uint64_t(1) << (l % 64);
+        }
+        any = any || !hits.empty();
+    }
+    if (any) _pairs[{mine->_id, theirs->_id}] = std::move(block);
+}
+
+// Drop the pairs and the last placement of the clue with this _id, and count it as edited.
+void puzzle_session::forget(int id) {
+    for (auto pair = _pairs.begin(); pair != _pairs.end();) {
+        if (pair->first.first == id || pair->first.second == id) {
+            pair = _pairs.erase(pair);
+        } else {
+            ++pair;
+        }
+    }
+    _placed.erase(id);
+    _edited.push_back(id);
+}
+
+bool puzzle_session::add_clue(int area, int x, int y, std::string& error) {
+    if (area < 1) {
+        error = "the area must be at least 1";
+        return false;
+    }
+    if (area > max_clue_area(_width, _height)) {
+        error = "the area can be at most " + std::to_string(max_clue_area(_width, _height)) + " on this board";
+        return false;
+    }
+    if (x < 0 || x >= _width || y < 0 || y >= _height) {
+        error = "square (" + std::to_string(x) + "," + std::to_string(y) + ") is off the board";
+        return false;
+    }
+    if (find_clue(x, y) >= 0) {
+        error = "square (" + std::to_string(x) + "," + std::to_string(y) + ") already has a clue";
+        return false;
+    }
+
+    int index = _clues.size();
+    _clues.emplace_back(_next_id++, Triangle(area, x, y, _width, _height));
+    cover(x, y, index, 1);
+    count_covering(index);
+    for (int k{}; k < index; k++) pair_up(index, k);
+    _edited.push_back(_clues[index]._id);
+    return true;
+}
+
+bool puzzle_session::move_clue(int x, int y, int to_x, int to_y, std::string& error) {
+    int index = find_clue(x, y);
+    if (index < 0) {
+        error = "there is no clue on square (" + std::to_string(x) + "," + std::to_string(y) + ")";
+        return false;
+    }
+    if (to_x < 0 || to_x >= _width || to_y < 0 || to_y >= _height) {
+        error = "square (" + std::to_string(to_x) + "," + std::to_string(to_y) + ") is off the board";
+        return false;
+    }
+    if (to_x == x && to_y == y) return true;
+    if (find_clue(to_x, to_y) >= 0) {
+        error = "square (" + std::to_string(to_x) + "," + std::to_string(to_y) + ") already has a clue";
+        return false;
+    }
+
+    int id = _clues[index]._id;
+    cover(x, y, index, -1);
+    forget(id);
+    _clues[index] = session_clue(id, Triangle(_clues[index]._triangle.getArea(), to_x, to_y, _width, _height));
+    cover(to_x, to_y, index, 1);
+    count_covering(index);
+    for (int k{}; k < _clues.size(); k++) {
+        if (k != index) pair_up(index, k);
+    }
+    return true;
+}
+
+bool puzzle_session::remove_clue(int x, int y, std::string& error) {
+    int index = find_clue(x, y);
+    if (index < 0) {
+        error = "there is no clue on square (" + std::to_string(x) + "," + std::to_string(y) + ")";
+        return false;
+    }
+    if (_clues.size() == 1) {
+        error = "the puzzle would have no clues";
+        return false;
+    }
+
+    cover(x, y, index, -1);
+    forget(_clues[index]._id);
+    _clues.erase(_clues.begin() + index);
+    return true;
+}
+
+uint64_t puzzle_session::solve(const search_options& options, search_stats* stats) {
+    // The board: each clue's candidates that cover no other clue's square. A clean clue's IDs in the last layout map
+    // to its IDs in this one in `moved`; everything else there maps to -1.
+    _board.clear();
+    vector<vector<int>> renumbered(_clues.size());
+    vector<char> clean(_clues.size()), keep;
+    vector<int> moved(_base._total, -1), kept;
+    std::map<int, int> index_of;
+    _scratch._first.assign(1, 0);
+    _scratch._bitboards.clear(_height, (_width + 63) / 64);
+    for (int i{}; i < _clues.size(); i++) {
+        session_clue& clue = _clues[i];
+        int first = _scratch._first.back();
+        keep.assign(clue._covering.size(), false);
+        renumbered[i].assign(clue._covering.size(), -1);
+        kept.clear();
+        for (int j{}; j < clue._covering.size(); j++) {
+            keep[j] = clue._covering[j] == 0;
+            if (!keep[j]) continue;
+            renumbered[i][j] = first + kept.size();
+            kept.push_back(j);
+            _scratch._bitboards.append(clue._bitboards, j);
+        }
+
+        clean[i] = clue._first >= 0 && kept == clue._kept;
+        for (int n{}; n < kept.size() && clean[i]; n++) moved[clue._first + n] = first + n;
+        clue._kept.swap(kept);
+        clue._first = first;
+
+        _board.push_back(clue._triangle);
+        _board.back().all_triangles.compact(keep);
+        _scratch._first.push_back(first + clue._kept.size());
+        index_of[clue._id] = i;
+    }
+
+    // The conflict matrix: clean clues' rows carried over from the last one, then the pairs with an unclean clue.
+    _scratch._total = _scratch._first.back();
+    _scratch._words = (_scratch._total + 63) / 64;
+    _scratch._bits.assign(size_t(_scratch._total) * _scratch._words, 0);
+    for (int old{}; old < _base._total; old++) {
+        int id = moved[old];
+        if (id < 0) continue;
+        const uint64_t* bits = _base.row(old);
+        uint64_t* row = &_scratch._bits[size_t(id) * _scratch._words];
+        for (int w{}; w < _base._words; w++) {
+            for (uint64_t word = bits[w]; word; word &= word - 1) {
+                int other = moved[w * 64 + __builtin_ctzll(word)];
+                if (other >= 0) row[other / 64] |= uint64_t(1) << (other % 64);
+            }
+        }
+    }
+    for (const auto& pair : _pairs) {
+        int mine = index_of[pair.first.first], theirs = index_of[pair.first.second];
+        if (clean[mine] && clean[theirs]) continue;
+
+        const vector<int>& rows = renumbered[mine];
+        const vector<int>& columns = renumbered[theirs];
+        const size_t words = (columns.size() + 63) / 64;
+        for (int j{}; j < rows.size(); j++) {
+            int id = rows[j];
+            if (id < 0) continue;
+            for (size_t w{}; w < words; w++) {
+                for (uint64_t bits = pair.second[j * words + w]; bits; bits &= bits - 1) {
+                    int other = columns[w * 64 + __builtin_ctzll(bits)];
+                    if (other < 0) continue;
+                    _scratch._bits[size_t(id) * _scratch._words + other / 64] |= uint64_t(1) << (other % 64);
+                    _scratch._bits[size_t(other) * _scratch._words + id / 64] |= uint64_t(1) << (id % 64);
+                }
+            }
+        }
+    }
+    std::swap(_base, _scratch);
+    _conflicts = _base;
+
+    // Starting from the last solution only needs the matrix; the whole board's arc consistency and value order are
+    // left for a search from the top, since they cost more than a search that has most of the board placed already.
+    uint64_t found = 0;
+    _solution_ids.clear();
+    _warm_start = 0;
+    search_stats attempt_stats;
+    if (stats) stats->reset(_clues.size());
+    if (options.limit == 1 && options.mode == search_mode::forward_checking && !_placed.empty()) {
+        std::unordered_set<int> freed(_edited.begin(), _edited.end());
+        for (int attempt = 1; attempt <= 2 && !found; attempt++) {
+            if (attempt == 2) {
+                // Free every clue with a candidate that conflicts with one of an edited clue's.
+                size_t edited = freed.size();
+                for (const auto& pair : _pairs) {
+                    if (freed.count(pair.first.first) || freed.count(pair.first.second)) {
+                        freed.insert(pair.first.first);
+                        freed.insert(pair.first.second);
+                    }
+                }
+                if (freed.size() == edited) break;
+            }
+
+            search_checkpoint warm;
+            warm.tasks.emplace_back();
+            for (int i{}; i < _clues.size(); i++) {
+                auto placed = _placed.find(_clues[i]._id);
+                if (freed.count(_clues[i]._id) || placed == _placed.end()) continue;
+                const placement_list& candidates = _board[i].all_triangles;
+                for (int j{}; j < candidates.size(); j++) {
+                    if (placement_key(candidates._ax[j], candidates._ay[j], candidates._bx[j], candidates._by[j],
+                                      candidates._cx[j], candidates._cy[j]) == placed->second) {
+                        warm.tasks[0].prefix.push_back(_conflicts._first[i] + j);
+                        break;
+                    }
+                }
+            }
+
+            search_options from_last = options;
+            from_last.resume = &warm;
+            from_last.checkpoint_path.clear();
+            found = parallel_solution(_board, _conflicts, from_last, _solution_ids, stats ? &attempt_stats : nullptr);
+            if (stats) stats->merge(attempt_stats);
+            if (found) _warm_start = attempt;
+        }
+    }
+    if (!found) {
+        propagate_arc_consistency(_board, _conflicts, _scratch);
+        if (options.value_order) order_least_constraining(_board, _conflicts, _scratch);
+        found = parallel_solution(_board, _conflicts, options, _solution_ids, stats ? &attempt_stats : nullptr);
+        if (stats) stats->merge(attempt_stats);
+    }
+
+    // Remember where this solution put every clue, for the next solve to start from.
+    if (found && !_solution_ids.empty()) {
+        _placed.clear();
+        for (int id : _solution_ids) {
+            int i = _conflicts.triangle_of(id);
+            const placement_list& candidates = _board[i].all_triangles;
+            int j = id - _conflicts._first[i];
+            _placed[_clues[i]._id] = placement_key(candidates._ax[j], candidates._ay[j], candidates._bx[j],
+                                                   candidates._by[j], candidates._cx[j], candidates._cy[j]);
+        }
+        _edited.clear();
+    }
+    return found;
+}
+
+////////////////////////////////////
+//            Solvers             //
+////////////////////////////////////
+
+puzzle_solver::puzzle_solver(const search_options& options)
+    : _options(options), _workspace(new search_workspace) {
+    _options.sink = nullptr;
+}
+
+puzzle_solver::~puzzle_solver() = default;
+
+void puzzle_solver::solve(const puzzle& start, solve_result& result, const placement_sink& sink) {
+    _board = start._board;
+    pre_process_valid_triangles(_board);
+    build_conflict_matrix(_board, _conflicts);
+    propagate_arc_consistency(_board, _conflicts, _scratch);
+    if (_options.value_order) order_least_constraining(_board, _conflicts, _scratch);
+
+    if (sink) {
+        _options.sink = [this, &sink](const vector<int>& placed_ids) {
+            placement_vertices(_board, _conflicts, placed_ids, _vertices);
+            sink(_vertices);
+        };
+    }
+    result.solutions = parallel_solution(_board, _conflicts, _options, _solution_ids, nullptr, _workspace.get());
+    _options.sink = nullptr;
+
+    result.placements.clear();
+    if (result.solutions && !_solution_ids.empty()) {
+        placement_vertices(_board, _conflicts, _solution_ids, result.placements);
+    }
+}
+
+batch_solver::batch_solver(int threads, const search_options& options) : _options(options) {
+    _options.threads = 1;
+    _options.checkpoint_path.clear();
+    _options.resume = nullptr;
+    for (int worker{}; worker < std::max(1, threads); worker++) {
+        _solvers.emplace_back(new puzzle_solver(_options));
+    }
+    for (int worker{}; worker < _solvers.size(); worker++) {
+        _threads.emplace_back(&batch_solver::work, this, worker);
+    }
+}
+
+batch_solver::~batch_solver() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closing = true;
+    }
+    _started.notify_all();
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+}
+
+void batch_solver::solve(const vector<puzzle>& puzzles, vector<solve_result>& results) {
+    std::lock_guard<std::mutex> turn(_turn);
+    results.resize(puzzles.size());
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _puzzles = &puzzles;
+    _results = &results;
+    _next.store(0);
+    _working = _threads.size();
+    _batch++;
+    _started.notify_all();
+    _finished.wait(lock, [this]() { return _working == 0; });
+}
+
+// One of the pool's threads: solve puzzles from each batch as it comes, until the batch_solver is destroyed.
+void batch_solver::work(int worker) {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+        _started.wait(lock, [&]() { return _closing || _batch != seen; });
+        if (_closing) return;
+        seen = _batch;
+        lock.unlock();
+
+        for (size_t i = _next.fetch_add(1); i < _puzzles->size(); i = _next.fetch_add(1)) {
+            _solvers[worker]->solve((*_puzzles)[i], (*_results)[i]);
+        }
+
+        lock.lock();
+        if (--_working == 0) _finished.notify_all();
+    }
+}
+
+}
@@ -0,0 +1,703 @@
+#ifndef TRI_TRI_SOLVER_H
+#define TRI_TRI_SOLVER_H
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <atomic>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <functional>
+#include <map>
+#include <utility>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace tritri {
+
+struct Point {
+    int x;
+    int y;
+    constexpr Point(int X, int Y) : x(X), y(Y) {};
+};
+
+/*
+ *  A list of candidate placements, one record per placement: placement i has its vertices at (_ax[i], _ay[i]),
+ *  (_bx[i], _by[i]) and (_cx[i], _cy[i]). Every coordinate gets an array of its own, so a pass over the list
+ *  reads them packed together, and every vertex is on a board read_puzzle accepts, so int16_t holds it.
+ */
+
+struct placement_list {
+    std::vector<int16_t> _ax, _ay, _bx, _by, _cx, _cy;
+
+    int size() const { return _ax.size(); }
+
+    Point a(int i) const { return Point(_ax[i], _ay[i]); }
+    Point b(int i) const { return Point(_bx[i], _by[i]); }
+    Point c(int i) const { return Point(_cx[i], _cy[i]); }
+
+    void push_back(int ax, int ay, int bx, int by, int cx, int cy);
+    void clear();
+
+    // Drop every placement i with keep[i] false, keeping the rest in order.
+    void compact(const std::vector<char>& keep);
+
+    // Keep only the placements listed in `indices`, in that order.
+    void select(const std::vector<int>& indices);
+};
+
+uint64_t placement_key(int ax, int ay, int bx, int by, int cx, int cy);
+
+/*
+ *  Important info in struct Point:
+ *  1. Triangle dimensions expressed as ordered pair (base, height)
+ *  2. All the possible offsets this (base, height) ordered pair can achieve while keeping the square (in the grid) 
+ *     inside it.
+ */
+
+struct valid_translations {
+    // Dimensions (variable: _dimensions) are represented as a point (x,y). 
+    // Actually represents dimensions as a (base, height) ordered pair.
+    Point _dimensions; 
+    std::vector<Point> _translations;
+    valid_translations(Point point, std::vector<Point> translations)
+        : _dimensions(point), _translations(translations) {}; 
+};
+
+
+/*
+ *  The eight ways of turning or flipping the plane that carry the square at (0, 0) onto itself, each as the matrix
+ *  (_xx _xy / _yx _yy) about the square's centre. A shape made pointing up, with its right angle bottom left, comes
+ *  out of the first four pointing up, right, down and left; the other four are their mirror images.
+ *
+ *  Mirroring a right angle triangle gives the same triangle as turning the one with its base and height swapped,
+ *  and create_dimensions lists both of those, so the rotations already reach every placement and its mirror image.
+ *  The mirror images would only add every candidate a second time, so shapes are made with rotation_count.
+ */
+
+struct dihedral_transform {
+    int _xx, _xy, _yx, _yy;
+
+    constexpr Point apply(Point p) const {
+        return Point(_xx * p.x + _xy * p.y + (1 - _xx - _xy) / 2, _yx * p.x + _yy * p.y + (1 - _yx - _yy) / 2);
+    }
+};
+
+constexpr dihedral_transform dihedral_transforms[] = {
+    { 1,  0,  0,  1},   // up
+    { 0,  1, -1,  0},   // right: (y, 1 - x)
+    {-1,  0,  0, -1},   // down: (1 - x, 1 - y)
+    { 0, -1,  1,  0},   // left: (1 - y, x)
+    {-1,  0,  0,  1},   // mirrored left to right: (1 - x, y)
+    { 1,  0,  0, -1},   // mirrored top to bottom: (x, 1 - y)
+    { 0,  1,  1,  0},   // mirrored across the diagonal: (y, x)
+    { 0, -1, -1,  0},   // mirrored across the other diagonal: (1 - y, 1 - x)
+};
+
+constexpr int rotation_count = 4;
+constexpr int dihedral_count = 8;
+
+/*
+ *  Everything about a triangle's candidates that depends only on its area: every (base, height) it can have with
+ *  the offsets that keep its square inside it (_combinations), and every way of laying it over its square in each
+ *  orientation, as three vertices each with the square at (0, 0) (_shapes).
+ */
+
+struct shape_template {
+    std::vector<valid_translations> _combinations;
+    std::vector<Point> _shapes;
+};
+
+// The shape_template for `area`, built the first time any clue of that area asks for it. Safe to call from any thread.
+const shape_template& shape_template_for(int area);
+
+/*
+ *      _x and _y are the X and Y coordinates of the right angle triangle.
+ *      _area is the area of the triangle.
+ *      _width and _height are the size of the board it sits on, in squares.
+ *      
+ *      _shape holds all the possible dimensions of the triangle, as well as the respective
+ *      valid offsets for each dimension, shared with every other triangle of the same area.
+ *
+ *      all_triangles holds all the possible valid triangle combinations (for each shape base/height combination) and each 
+ *      triangle orientation, one record per placement.
+ *
+ *      _duplicates is how many placements make_combinations came across more than once and kept only the first of.
+ */
+
+class Triangle {
+    private:
+
+        int _x;
+        int _y;
+        int _area;
+        int _width;
+        int _height;
+        const shape_template* _shape;
+        int _duplicates;
+    
+        template <int Width, int Height>
+        int make_combinations_on(int X, int Y, int width, int height, const std::vector<Point>& shapes,
+                                  placement_list& allTriangles);
+
+    public:
+
+        placement_list all_triangles; 
+
+        Triangle(int area, int x, int y, int width, int height)
+            : _x(x), _y(y), _area(area), _width(width), _height(height), _shape(&shape_template_for(area)),
+              _duplicates(0) {
+            make_combinations(_x,_y,_width,_height,_shape->_shapes,all_triangles);
+        };
+
+        static void create_dimensions(int area, std::vector<valid_translations>& combinations);
+        template <int Orientations = rotation_count>
+        static void make_shapes(const std::vector<valid_translations>& combinations, std::vector<Point>& shapes);
+        void make_combinations(int x, int y, int width, int height, const std::vector<Point>& shapes,
+                               placement_list& allTriangles);
+
+        static std::vector<Point> translate(Point dimensions);
+
+        int inline getXC() const {return _x;};
+        int inline getYC() const {return _y;};
+        int inline getArea() const {return _area;};
+        int inline getWidth() const {return _width;};
+        int inline getHeight() const {return _height;};
+        int inline getDuplicates() const {return _duplicates;};
+
+        void print_dimensions() const;
+        void print_triangles() const;
+        
+        const std::vector<valid_translations>& getCombinations() const {return _shape->_combinations;};
+};
+
+////////////////////////////////////
+//   Point Comparison Functions   //
+////////////////////////////////////
+
+bool is_on_same_line(Point p, Point q, Point r);
+int orientation(Point p, Point q, Point r);
+bool do_intersect(Point p1, Point q1, Point p2, Point q2);
+int sign (Point p1, Point p2, Point p3);
+bool is_inside_triangle (Point pt, Point v1, Point v2, Point v3);
+bool is_triangle_contained_in_another_triangle(std::vector<Point>& triangle_vertices, Point p, Point q, Point r);
+bool triangle_contains_another_triangle(std::vector<Point>& triangle_vertices, Point p, Point q, Point r);
+long long turn(Point o, Point u, Point v);
+bool placements_conflict(const placement_list& mine, int i, const placement_list& theirs, int j);
+void placements_conflicting(const placement_list& mine, int i, const placement_list& theirs, std::vector<int>& hits);
+bool covers_square(const placement_list& placements, int i, int x, int y);
+bool covers_whole_square(const placement_list& placements, int i, int x, int y);
+
+/*
+ *  Why two triangles conflict: some pair of their edges cross, the first sits inside the second, or the first
+ *  has the second inside it. Overlaps where the edges only touch or run along each other count as edge
+ *  crossings. prune_emptied_domain and prune_nogood are for search_stats; see there.
+ */
+
+enum prune_reason {
+    prune_edge_crossing, prune_contained_in, prune_contains, prune_emptied_domain, prune_nogood, prune_reasons
+};
+
+prune_reason conflict_reason(const placement_list& mine, int i, const placement_list& theirs, int j);
+
+////////////////////////////////////
+//           Bitboards            //
+////////////////////////////////////
+
+/*
+ *  Every candidate placement rasterised onto the squares of the board, one bit per square, stored a board row at
+ *  a time with _row_words 64-bit words per row (bit x % 64 of word x / 64 is square x). Placement IDs are the same
+ *  as in conflict_matrix.
+ *
+ *  A placement only has rows from _bottom[id] up to (not including) _top[id], starting at _offset[id] in both
+ *  pools: _interior has the squares the placement covers completely, _covered every square it covers any part of.
+ *  _left and _right finish off its bounding box, in vertex coordinates like _bottom and _top.
+ *
+ *  A square that one triangle covers completely can't share any area with another, so two placements certainly
+ *  overlap if either one's interior meets the other's covered squares, and certainly don't if their covered
+ *  squares are apart. What's left is pairs that only share squares both of them cut through, which need
+ *  placements_conflict.
+ */
+
+struct placement_bitboards {
+    int _height;
+    int _row_words;
+    std::vector<int> _left, _right, _bottom, _top;
+    std::vector<int> _offset;
+    std::vector<uint64_t> _interior;
+    std::vector<uint64_t> _covered;
+
+    // 1 if placement `id` overlaps the occupied squares (_height * _row_words words each), 0 if it doesn't,
+    // -1 if the squares can't tell.
+    int compare_occupied(int id, const uint64_t* interior, const uint64_t* covered) const;
+
+    // Empty it out for placements on a board `height` rows of `row_words` words, keeping the space.
+    void clear(int height, int row_words);
+
+    // Copy placement `id` of `from`, rasterised for a board of the same size, in as the next placement here.
+    void append(const placement_bitboards& from, int id);
+};
+
+placement_bitboards rasterise_placements(const std::vector<Triangle>& board);
+void rasterise_placements(const std::vector<Triangle>& board, placement_bitboards& boards);
+
+////////////////////////////////////
+//        Conflict Matrix         //
+////////////////////////////////////
+
+/*
+ *  Every candidate placement on the board gets a global ID. The candidates of board[0] come first, then
+ *  those of board[1], and so on: the candidates of board[i] are IDs _first[i] up to (not including) _first[i + 1],
+ *  in the same order as they sit in board[i].all_triangles.
+ *
+ *  Row `id` is a packed bitset, _words 64-bit words long, with a bit set for every placement that conflicts
+ *  with placement `id`. Candidates of the same triangle are never on the board together, so they are never marked.
+ *  build_conflict_matrix tests every pair exactly once, instead of at every node of the search, and rasterises
+ *  the placements into _bitboards for the search's own use.
+ */
+
+struct conflict_matrix {
+    int _total = 0;
+    int _words = 0;
+    std::vector<int> _first;
+    std::vector<uint64_t> _bits;
+    placement_bitboards _bitboards;
+
+    const uint64_t* row(int id) const { return &_bits[size_t(id) * _words]; }
+
+    // True if placement `id` conflicts with anything set in the bitset `placed`.
+    bool conflicts_with(int id, const uint64_t* placed) const {
+        const uint64_t* bits = row(id);
+        uint64_t hit = 0;
+        for (int w{}; w < _words; w++) {
+            hit |= bits[w] & placed[w];
+        }
+        return hit != 0;
+    }
+
+    // The board index of the triangle placement `id` belongs to.
+    int triangle_of(int id) const {
+        return std::upper_bound(_first.begin(), _first.end(), id) - _first.begin() - 1;
+    }
+};
+
+conflict_matrix build_conflict_matrix(const std::vector<Triangle>& board);
+void build_conflict_matrix(const std::vector<Triangle>& board, conflict_matrix& conflicts);
+int count_in_range(const uint64_t* bits, int from, int to);
+bool any_outside_row(const uint64_t* alive, const uint64_t* row, int from, int to);
+int propagate_arc_consistency(std::vector<Triangle>& board, conflict_matrix& conflicts);
+void order_least_constraining(std::vector<Triangle>& board, conflict_matrix& conflicts);
+
+// The same, renumbering into `scratch` and swapping it in, so that the matrix given up is kept there for next time.
+int propagate_arc_consistency(std::vector<Triangle>& board, conflict_matrix& conflicts, conflict_matrix& scratch);
+void order_least_constraining(std::vector<Triangle>& board, conflict_matrix& conflicts, conflict_matrix& scratch);
+
+/*
+ *  Cube and conquer: cut the search up into independent subproblems ("cubes") by placing `depth` triangles every way
+ *  forward checking allows, taking the unplaced triangle with the fewest candidates left each time. Each cube goes
+ *  to the sink as a domains bitset over placement IDs: its one candidate for every placed triangle, and what's still
+ *  alive for the rest. A placement that leaves some triangle nothing makes no cube. Every solution is in exactly
+ *  one cube.
+ */
+
+using cube_sink = std::function<void(const uint64_t* domains)>;
+
+uint64_t expand_cubes(const conflict_matrix& conflicts, int depth, const cube_sink& sink);
+
+////////////////////////////////////
+//   Preprocessing and Solution   //
+////////////////////////////////////
+
+void pre_process_valid_triangles(std::vector<Triangle>& board);
+void print_solution(std::ostream& out, const std::vector<Point>& board);
+void print_placements(std::ostream& out, const std::vector<Triangle>& board, const conflict_matrix& conflicts,
+                      const std::vector<int>& placed_ids);
+void placement_vertices(const std::vector<Triangle>& board, const conflict_matrix& conflicts,
+                        const std::vector<int>& placed_ids, std::vector<Point>& vertices);
+
+/*
+ *  static_order places the triangles in board order and checks each candidate against what has been placed.
+ *
+ *  forward_checking keeps a live domain for every triangle still to be placed (see search_stack and
+ *  place_candidate) and always places the triangle with the fewest candidates left next.
+ */
+
+enum class search_mode { static_order, forward_checking };
+
+/*
+ *  A task is a partial solution: the placement IDs already fixed, one per triangle, in the order they were placed.
+ *  Solving a task means searching every completion of that prefix. If choices isn't empty, the next placement is
+ *  one of those candidates (all of the same triangle), tried in that order, rather than any at all.
+ *
+ *  A search_checkpoint is everything a search has still to do, as tasks, and how many solutions it had found by then,
+ *  with the placement IDs of the first of those in first_solution, so that a resumed search can still hand it back.
+ *  fingerprint is the placement_fingerprint of the board it belongs to, and mode the search_mode that left the
+ *  tasks: static_order's prefixes are always the first triangles in board order, forward_checking's any of them.
+ */
+
+struct search_task {
+    std::vector<int> prefix;
+    std::vector<int> choices;
+};
+
+struct search_checkpoint {
+    uint64_t fingerprint = 0;
+    search_mode mode = search_mode::forward_checking;
+    uint64_t solutions = 0;
+    std::vector<int> first_solution;
+    std::vector<search_task> tasks;
+};
+
+/*
+ *  How a search runs:
+ *
+ *  threads           how many workers share the work-stealing pool.
+ *  split_depth       how many of the first placements get handed out as separate tasks; deeper means more,
+ *                    smaller tasks. Only placements with a choice count: a triangle down to one candidate is
+ *                    placed in the same task, so forced placements at the top don't leave one task for everybody.
+ *  stop              if set, raising it ends the search early; whatever was found up to then still counts.
+ *  progress_seconds  if above zero, a sampled progress line goes to std::cerr this often.
+ *  limit             the search stops once it has found this many solutions. 0 means find them all.
+ *  sink              if set, called with each solution as it is found: the placement ID chosen for every triangle,
+ *                    in the order they were placed. Calls never overlap, but come in no particular order. Without a
+ *                    sink solutions are only counted, apart from the first, which parallel_solution hands back.
+ *  backjumping       if set, a depth that runs out of candidates backs up straight to the deepest placement that
+ *                    helped rule them out (conflict-directed backjumping), rather than just to the one before it.
+ *  nogood_capacity   with backjumping, how many learned nogoods (sets of placements that can't all be in a
+ *                    solution) each worker keeps to turn candidates down with. 0 learns none.
+ *  value_order       in forward_checking, try each triangle's live candidates least constraining first: the ones
+ *                    that take the fewest candidates out of the domains still to be filled go first. Otherwise
+ *                    they are tried in ID order (see order_least_constraining).
+ *  seed              if not 0, break ties at random, seeded from this: between equally small domains in
+ *                    forward_checking, and between equally constraining candidates (or all of them, without
+ *                    value_order). Each worker gets its own stream.
+ *  restart_nodes     if not 0 and limit is 1, restart the search from scratch whenever a run has reached this
+ *                    many nodes times the next term of the Luby sequence (1 1 2 1 1 2 4 ...). With a seed every run
+ *                    goes a different way, and learned nogoods carry over. Restarting runs a single worker, with
+ *                    no splitting.
+ *  checkpoint_path   if set, every checkpoint_seconds the workers pause while what's left of the search is saved
+ *                    here (see save_checkpoint). The pause costs about as much as writing out a task for every
+ *                    candidate still to be tried on the workers' current paths, and whatever is waiting in the pool.
+ *  resume            if set, the search carries on from this checkpoint instead of starting from the top, with
+ *                    the solutions it had found already counted.
+ */
+
+using solution_sink = std::function<void(const std::vector<int>& placed_ids)>;
+
+struct search_options {
+    search_mode mode = search_mode::forward_checking;
+    int threads = 1;
+    int split_depth = 3;
+    const std::atomic<bool>* stop = nullptr;
+    double progress_seconds = 0;
+    uint64_t limit = 1;
+    solution_sink sink;
+    bool backjumping = true;
+    int nogood_capacity = 4096;
+    bool value_order = true;
+    uint64_t seed = 0;
+    uint64_t restart_nodes = 0;
+    std::string checkpoint_path;
+    double checkpoint_seconds = 60;
+    const search_checkpoint* resume = nullptr;
+};
+
+/*
+ *  What a search did, to see where it spends its time. Only collected when asked for, since it costs a little
+ *  at every node.
+ *
+ *  nodes[d]   how many times the search reached depth d, with d triangles on the board.
+ *  tried[k]   how many candidates of board[k] were tried.
+ *  pruned[r]  how many candidates were thrown out for prune_reason r, against the first placed triangle they conflict
+ *             with. In forward_checking mode these are the candidates each placement takes out of the other domains,
+ *             and prune_emptied_domain counts placements turned down because they left an unplaced triangle with
+ *             no candidates at all. prune_nogood counts candidates turned down by a learned nogood.
+ *  backjumps  how many times the search backed up past more than one depth at once.
+ *  nogoods    how many nogoods were learned.
+ *  restarts   how many times the search gave up on a run and started over.
+ *  tasks      how many tasks the workers ran, including restarts and ones carried over from a checkpoint.
+ */
+
+struct search_stats {
+    std::vector<uint64_t> nodes;
+    std::vector<uint64_t> tried;
+    uint64_t pruned[prune_reasons] = {};
+    uint64_t backjumps = 0;
+    uint64_t nogoods = 0;
+    uint64_t restarts = 0;
+    uint64_t tasks = 0;
+
+    void reset(int triangles);
+    void merge(const search_stats& other);
+    uint64_t total_nodes() const;
+};
+
+void print_stats(std::ostream& out, const std::vector<Triangle>& board, const search_stats& stats);
+void print_duplicates(std::ostream& out, const std::vector<Triangle>& board);
+
+struct search_workspace;
+
+uint64_t parallel_solution(const std::vector<Triangle>& board, const conflict_matrix& conflicts,
+                           const search_options& options, std::vector<int>& solution_ids,
+                           search_stats* stats = nullptr, search_workspace* workspace = nullptr);
+
+/*
+ *  A portfolio runs several differently configured searches at once, one thread each, for the first solution.
+ *  Whichever strategy settles the puzzle first, by finding a solution or by running out of tree, cancels the rest.
+ *  default_portfolio gives `count` strategies: strategy 0 is the default search and strategy 1 static_order, and
+ *  the rest mix the two modes with and without value_order, each with its own seed and restart schedule.
+ */
+
+std::vector<search_options> default_portfolio(int count, uint64_t seed);
+uint64_t portfolio_solution(const std::vector<Triangle>& board, const conflict_matrix& conflicts,
+                            const std::vector<search_options>& strategies, std::vector<int>& solution_ids, int& winner,
+                            std::vector<search_stats>* stats = nullptr);
+void print_portfolio_stats(std::ostream& out, const std::vector<search_options>& strategies,
+                           const std::vector<search_stats>& stats, int winner);
+
+/*
+ *  A search_options::sink that writes every solution it is given to `out`, as print_placements would, collecting
+ *  them in memory and passing them on a block at a time so that a search with a great many solutions isn't held up
+ *  by the stream. flush() writes out whatever is left; so does the destructor.
+ */
+
+struct solution_writer {
+    std::ostream& _out;
+    const std::vector<Triangle>& _board;
+    const conflict_matrix& _conflicts;
+    std::ostringstream _buffer;
+
+    solution_writer(std::ostream& out, const std::vector<Triangle>& board, const conflict_matrix& conflicts)
+        : _out(out), _board(board), _conflicts(conflicts) {};
+    ~solution_writer() { flush(); }
+
+    void write(const std::vector<int>& placed_ids);
+    void flush();
+};
+
+////////////////////////////////////
+//         Puzzle Files           //
+////////////////////////////////////
+
+/*
+ *  A puzzle file is whitespace separated integers: the board's width and height in squares, then one
+ *  "area x y" line per clue, giving the clue's area and the square it sits in. Anything after a '#' on a
+ *  line is a comment. See puzzles/tri_tri_again_again.txt.
+ */
+
+struct puzzle {
+    int _width;
+    int _height;
+    std::vector<Triangle> _board;
+};
+
+// The largest area a clue can have on a width by height board: half the board, with the legs along two of its sides.
+// read_puzzle, read_subproblem and puzzle_session turn down anything bigger, which would only build shapes for nothing.
+int max_clue_area(int width, int height);
+
+bool read_puzzle(std::istream& in, puzzle& loaded, std::string& error);
+puzzle published_puzzle();
+
+/*
+ *  A subproblem file is a puzzle with some of the search already done, such as a cube from expand_cubes. After the
+ *  board's width and height, each clue is "area x y count" followed by its `count` remaining candidates, each as six
+ *  vertex coordinates "ax ay bx by cx cy". Only those candidates are searched, so a clue with one is as good as
+ *  placed. Comments work as they do in puzzle files. Every candidate must be one make_combinations gives its clue;
+ *  read_subproblem turns the file down otherwise, since a cube from another machine is only worth trusting that far.
+ */
+
+void write_subproblem(std::ostream& out, const std::vector<Triangle>& board, const conflict_matrix& conflicts,
+                      const uint64_t* domains);
+bool read_subproblem(std::istream& in, puzzle& loaded, std::string& error);
+
+////////////////////////////////////
+//          Checkpoints           //
+////////////////////////////////////
+
+/*
+ *  A checkpoint file is "tritri-checkpoint fingerprint mode solutions tasks", mode being "fc" or "static", then the
+ *  first solution, as the number of IDs in it (0 before there is one) and the IDs, then one line per task: the
+ *  length of its prefix and the IDs in it, then the number of choices and those IDs. Placement
+ *  IDs are only good for the board they were handed out on, which the fingerprint identifies, and tasks only for
+ *  the search_mode that left them, so read_checkpoint fails for another board or another mode. It also turns down
+ *  any task the search couldn't have left (see valid_task), and a first solution that isn't one.
+ *
+ *  save_checkpoint writes the file beside `path` and renames it into place, so that `path` is always a whole
+ *  checkpoint, old or new, however the program stops.
+ */
+
+uint64_t placement_fingerprint(const std::vector<Triangle>& board);
+void write_checkpoint(std::ostream& out, const search_checkpoint& checkpoint);
+bool valid_task(const conflict_matrix& conflicts, search_mode mode, const search_task& task);
+bool read_checkpoint(std::istream& in, const std::vector<Triangle>& board, const conflict_matrix& conflicts,
+                     search_mode mode, search_checkpoint& checkpoint, std::string& error);
+bool save_checkpoint(const std::string& path, const search_checkpoint& checkpoint);
+
+////////////////////////////////////
+//        Editing Sessions        //
+////////////////////////////////////
+
+/*
+ *  A puzzle being edited a clue at a time, kept ready to be solved again after every edit. It keeps each clue's
+ *  candidates as the Triangle made them (_triangle) and, for every pair of clues whose candidates can reach each
+ *  other, which of their candidates conflict (_pairs, keyed by clue _id, smaller first, with a row of bits over the
+ *  second clue's candidates for each of the first's). _covering counts, for each candidate, the other clues' squares
+ *  it covers, and the ones covering none are what pre_process_valid_triangles would keep.
+ *
+ *  An edit only redoes what it touches: the clue's own candidates, their bitboards (_bitboards) and pairs, and the
+ *  covering counts of candidates that reach its old or new square. solve() then lays the board out again, and a
+ *  clue whose kept candidates are the ones it had last time (_kept, from ID _first) is clean. Its rows come over from
+ *  the last solve's matrix (_base) with the IDs moved along, and only the rows and columns of the rest are filled in
+ *  from their pairs. The bitboards are copied from the clues, so no candidate is ever rasterised twice.
+ *
+ *  When looking for one solution in forward_checking, solve() starts from the last solution it found: first with
+ *  every clue the edits since left alone kept where it was, then with the clues next to the edited ones free to
+ *  move too. These are searches of tasks with those placements as the prefix, so anything they find is a solution of
+ *  the whole puzzle, and a removed clue is answered straight away. Failing that, or for anything else, it runs
+ *  propagate_arc_consistency, order_least_constraining (with value_order) and the search from the top, as main() does.
+ *
+ *  Clues are found by their square, so a session won't put two clues on one square.
+ */
+
+struct session_clue {
+    int _id;
+    Triangle _triangle;
+    std::vector<int> _covering;
+    int _left, _right, _bottom, _top;
+    placement_bitboards _bitboards;
+    std::vector<int> _kept;
+    int _first = -1;
+
+    session_clue(int id, const Triangle& triangle);
+};
+
+class puzzle_session {
+    private:
+
+        // The bookkeeping behind the edits: the clue on a square, covering counts and pairs, and forgetting a clue.
+        int find_clue(int x, int y) const;
+        void cover(int x, int y, int by, int change);
+        void count_covering(int index);
+        void pair_up(int index, int other);
+        void forget(int id);
+
+        // The matrix the last solve() laid out, before arc consistency and value ordering, and one to build in next.
+        conflict_matrix _base;
+        conflict_matrix _scratch;
+
+    public:
+
+        int _width;
+        int _height;
+        int _next_id = 0;
+        std::vector<session_clue> _clues;
+        std::map<std::pair<int, int>, std::vector<uint64_t>> _pairs;
+
+        // Where the last solution put each clue, as placement_key by clue _id, and the clues edited since.
+        std::map<int, uint64_t> _placed;
+        std::vector<int> _edited;
+
+        // What the last solve() searched, to print its solution from.
+        std::vector<Triangle> _board;
+        conflict_matrix _conflicts;
+        std::vector<int> _solution_ids;
+        int _warm_start = 0;
+
+        explicit puzzle_session(const puzzle& start);
+
+        bool add_clue(int area, int x, int y, std::string& error);
+        bool move_clue(int x, int y, int to_x, int to_y, std::string& error);
+        bool remove_clue(int x, int y, std::string& error);
+
+        // Search the puzzle as it now stands, as parallel_solution does; _warm_start says how the answer was found:
+        // 1 with the untouched clues kept where they were, 2 with their neighbours freed as well, 0 from the top.
+        // `stats` adds up every search it took to get there, not just the last.
+        uint64_t solve(const search_options& options, search_stats* stats = nullptr);
+};
+
+////////////////////////////////////
+//            Solvers             //
+////////////////////////////////////
+
+/*
+ *  How solving a puzzle went: how many solutions were found (no more than search_options::limit, if that is set),
+ *  and the first of them as placements, three vertices per clue in the puzzle's order, as print_solution takes them.
+ *  placements is empty if there was no solution.
+ */
+
+struct solve_result {
+    uint64_t solutions = 0;
+    std::vector<Point> placements;
+};
+
+// Called with every solution as it is found, laid out as solve_result::placements.
+using placement_sink = std::function<void(const std::vector<Point>& placements)>;
+
+/*
+ *  Solves puzzles for a program that links TriTriSolver instead of running TriTriAgainAgain, one after another, the
+ *  way main() does: pre_process_valid_triangles, build_conflict_matrix, propagate_arc_consistency,
+ *  order_least_constraining (with value_order) and parallel_solution. The board, the conflict matrix, the search's
+ *  stacks and nogood caches and the solution are kept from one solve() to the next and only ever grow. Arc consistency
+ *  and value ordering renumber into _scratch and swap it with _conflicts, so the two take turns. Once the solver has
+ *  seen a puzzle as big as the next one, the matrix and its bitboards are never allocated again; what's left is the
+ *  small working lists of the passes themselves.
+ *
+ *  Every search runs with _options, apart from their sink: solve() calls `sink`, if given, instead. A solver is for
+ *  one thread at a time.
+ */
+
+struct puzzle_solver {
+    search_options _options;
+    std::vector<Triangle> _board;
+    conflict_matrix _conflicts;
+    conflict_matrix _scratch;
+    std::vector<int> _solution_ids;
+    std::vector<Point> _vertices;
+    std::unique_ptr<search_workspace> _workspace;
+
+    explicit puzzle_solver(const search_options& options = search_options());
+    ~puzzle_solver();
+
+    void solve(const puzzle& start, solve_result& result, const placement_sink& sink = nullptr);
+};
+
+/*
+ *  A pool of threads, started once, that solve batches of independent puzzles. Each thread has a puzzle_solver of
+ *  its own and takes the batch's next unsolved puzzle until none are left, so a stream of small puzzles is solved
+ *  `threads` at a time without starting a thread or giving back a buffer between them. Every puzzle is searched on
+ *  the one thread with _options, less any checkpoint.
+ *
+ *  solve() fills results[i] for puzzles[i] and returns once the whole batch is done. Batches from several threads
+ *  take turns.
+ */
+
+struct batch_solver {
+    search_options _options;
+    std::vector<std::unique_ptr<puzzle_solver>> _solvers;
+    std::vector<std::thread> _threads;
+
+    std::mutex _turn;
+    std::mutex _mutex;
+    std::condition_variable _started;
+    std::condition_variable _finished;
+    const std::vector<puzzle>* _puzzles = nullptr;
+    std::vector<solve_result>* _results = nullptr;
+    std::atomic<size_t> _next{0};
+    uint64_t _batch = 0;
+    int _working = 0;
+    bool _closing = false;
+
+    explicit batch_solver(int threads, const search_options& options = search_options());
+    ~batch_solver();
+
+    void solve(const std::vector<puzzle>& puzzles, std::vector<solve_result>& results);
+    void work(int worker);
+};
+
+}
+
+#endif
@@ -0,0 +1,43 @@
+#!/usr/bin/env bash
+#
+#  Usage: corrupted_cube.sh TRI_TRI_AGAIN_AGAIN PUZZLE
+#
+#  Cuts PUZZLE into cubes, then swaps the first candidate of the first cube's first clue for a triangle that clue
+#  can't have: one with no area, one of the wrong area, and one that misses the clue's square. Every vertex is still
+#  on the board, so only checking the candidate against the clue catches them. --subproblem must turn each of them
+#  down as a bad file (exit status 2, not just 1 for no solution), and still take the cube as written.
+#
+#  The swapped in triangles are made for tests/puzzles/small-6x6.txt, whose first clue is an area 2 in square (1, 1).
+
+solver=$1
+puzzle=$2
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+failures=0
+
+"$solver" --cubes 1 --processes 0 --cube-dir "$work/cubes" "$puzzle" >/dev/null
+cube="$work/cubes/cube-000001.txt"
+
+if ! "$solver" --count --subproblem "$cube" >/dev/null 2>&1; then
+    echo "FAIL: the cube as written was turned down"
+    failures=$((failures + 1))
+else
+    echo "ok: the cube as written"
+fi
+
+# The first candidate is the line after the first clue's "area x y count" line.
+first=$(awk '!/^#/ && NF { lines++ } lines == 3 { print NR; exit }' "$cube")
+
+for candidate in "0 0 0 0 0 0" "1 1 5 1 1 5" "3 3 5 3 3 5"; do
+    sed "${first}s/.*/  $candidate/" "$cube" > "$work/corrupted.txt"
+    "$solver" --count --subproblem "$work/corrupted.txt" >/dev/null 2>&1
+    if [ $? -ne 2 ]; then
+        echo "FAIL: a cube with candidate '$candidate' was taken"
+        failures=$((failures + 1))
+    else
+        echo "ok: a cube with candidate '$candidate' was turned down"
+    fi
+done
+
+[ "$failures" -eq 0 ]
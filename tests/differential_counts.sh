@@ -0,0 +1,40 @@
+#!/usr/bin/env bash
+#
+#  Usage: differential_counts.sh TRI_TRI_AGAIN_AGAIN PUZZLE EXPECTED
+#
+#  Counts the solutions of PUZZLE every way the search can be run: both modes, one thread and several, with and
+#  without backjumping, with no nogoods and with a tiny cache, in ID order or seeded, and cut into cubes solved by
+#  worker processes. Every count must come out as EXPECTED. Any that doesn't is listed, and the exit status is 1.
+
+solver=$1
+puzzle=$2
+expected=$3
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+failures=0
+
+check() {
+    local got
+    got=$("$solver" --count "$@" "$puzzle")
+    if [ "$got" != "$expected" ]; then
+        echo "FAIL: --count $* gave '$got', expected $expected"
+        failures=$((failures + 1))
+    else
+        echo "ok: --count $*"
+    fi
+}
+
+for mode in fc static; do
+    check --mode "$mode" --threads 1
+    check --mode "$mode" --threads 3 --split-depth 1
+    check --mode "$mode" --threads 4 --split-depth 4
+    check --mode "$mode" --threads 1 --no-backjump
+    check --mode "$mode" --threads 2 --nogoods 0
+    check --mode "$mode" --threads 1 --nogoods 2
+    check --mode "$mode" --threads 2 --no-value-order --seed 7
+    check --mode "$mode" --cubes 1 --cube-dir "$work/cubes-$mode-1" --processes 2
+    check --mode "$mode" --cubes 3 --cube-dir "$work/cubes-$mode-3" --processes 3 --nogoods 2
+done
+
+[ "$failures" -eq 0 ]
@@ -0,0 +1,62 @@
+#!/usr/bin/env bash
+#
+#  Usage: kill_resume.sh TRI_TRI_AGAIN_AGAIN PUZZLE EXPECTED
+#
+#  Counts the solutions of PUZZLE with a checkpoint taken every few milliseconds, killing the search (SIGKILL, so
+#  nothing gets to tidy up) again and again and resuming it from the checkpoint until a run gets to the end. The
+#  final count must be EXPECTED, for both modes on one thread and on several. Wherever the kills land the total
+#  can't change; a run killed before its first checkpoint just starts again from the top.
+#
+#  A checkpoint must also refuse to be resumed in the other mode. Resumed to print the first solution, it must print
+#  one whether or not the checkpoint had found it: on one thread the same one as a search from the top, and on
+#  several one with as many placements, none of them left at zero.
+
+solver=$1
+puzzle=$2
+expected=$3
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+failures=0
+
+for mode in fc static; do
+    "$solver" --mode "$mode" --threads 1 "$puzzle" > "$work/first-$mode.txt"
+    for threads in 1 3; do
+        checkpoint="$work/$mode-$threads.checkpoint"
+        kills=0
+        for attempt in $(seq 1 200); do
+            got=$(timeout -s KILL 0.08 "$solver" --count --mode "$mode" --threads "$threads" \
+                  --checkpoint "$checkpoint" --checkpoint-every 0.01 --resume "$puzzle")
+            [ $? -ne 137 ] && break
+            kills=$((kills + 1))
+
+            other=$([ "$mode" = fc ] && echo static || echo fc)
+            if [ -e "$checkpoint" ] &&
+               "$solver" --count --mode "$other" --checkpoint "$checkpoint" --resume "$puzzle" >/dev/null 2>&1; then
+                echo "FAIL: a --mode $mode checkpoint was resumed with --mode $other"
+                failures=$((failures + 1))
+            fi
+
+            if [ -e "$checkpoint" ]; then
+                cp "$checkpoint" "$work/first.checkpoint"
+                first=$("$solver" --mode "$mode" --threads "$threads" --checkpoint "$work/first.checkpoint" \
+                        --resume "$puzzle")
+                if { [ "$threads" -eq 1 ] && [ "$first" != "$(cat "$work/first-$mode.txt")" ]; } ||
+                   [ "$(echo "$first" | grep -c Printing)" -ne "$(grep -c Printing "$work/first-$mode.txt")" ] ||
+                   echo "$first" | grep -q "(0,0) | (0,0) | (0,0)"; then
+                    echo "FAIL: resuming a --mode $mode checkpoint on $threads threads didn't print the first solution"
+                    failures=$((failures + 1))
+                fi
+            fi
+        done
+
+        if [ "$got" != "$expected" ]; then
+            echo "FAIL: --mode $mode --threads $threads gave '$got' after $kills kills, expected $expected"
+            failures=$((failures + 1))
+        else
+            echo "ok: --mode $mode --threads $threads, $kills kills"
+        fi
+    done
+done
+
+[ "$failures" -eq 0 ]